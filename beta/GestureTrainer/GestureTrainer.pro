@@ -6,8 +6,10 @@
 
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 QMAKE_CXXFLAGS = -fpermissive -std=c++11
+# SSE2 is on by default for 64 bit x86, uncomment for the AVX2 kernels
+# QMAKE_CXXFLAGS += -mavx2
 
 TARGET = GestureTrainer
 TEMPLATE = app
@@ -23,14 +25,38 @@ SOURCES += main.cpp\
 HEADERS  += forms/mainwindow.h \
     include/colorhistogram.h \
     detectors/skindetector.h \
+    detectors/skinmodels.h \
     detectors/skindetectcontroller.h \
     detectors/handdetectcontroller.h \
     detectors/handdetector.h \
     include/hand.h \
+    include/handfeatures.h \
+    include/gesturemodel.h \
+    include/maskchange.h \
+    include/palmtracker.h \
+    include/pointkernels.h \
+    include/templategallery.h \
+    include/gesturedataset.h \
+    include/detectorparams.h \
+    include/motiongesture.h \
+    include/gesturevoter.h \
+    include/framedisplay.h \
+    include/displayscheduler.h \
+    include/livehistogram.h \
+    include/userprofile.h \
+    include/framesource.h \
     include/user.h
 
 FORMS    +=  forms/mainwindow.ui
 
+# kiosk builds (qmake CONFIG+=kiosk) compile the trained gesture model in,
+# regenerate include/gesturetree.h with tools/gesturegen after training (the
+# checked-in placeholder is empty and stops the build)
+kiosk {
+    DEFINES += GESTURE_COMPILED_MODEL
+    HEADERS += include/gesturetree.h
+}
+
 INCLUDEPATH += /opt/local/include/
 LIBS += -L/opt/local/lib/ \
    -lopencv_core \
@@ -39,6 +65,7 @@ LIBS += -L/opt/local/lib/ \
    -lopencv_features2d \
    -lopencv_objdetect \
    -lopencv_calib3d \
+   -lopencv_video \
 
 RESOURCES += \
     res.qrc
@@ -40,9 +40,11 @@ class HandDetectController
 		Hand lastHand;
 
 	public:
+		// The face cascade is loaded by loadCascade, not here, so the
+		// first use does not stall on it
 		HandDetectController()
 		{
-			handDetect = new HandDetector();
+			handDetect = new HandDetector(false);
 		}
 
 		// Deletes all processor objects created by the controller.
@@ -109,12 +111,52 @@ class HandDetectController
 			return lastHand;
 		}
 
+		const std::vector<cv::Rect> getLastFaces() const
+		{
+			return handDetect->getFaces();
+		}
+
+		// True if the hand was kept from the frame before (held pose)
+		bool lastHandReused() const
+		{
+			return handDetect->lastHandWasReused();
+		}
+
+		void setParams(const DetectorParams& p)
+		{
+			handDetect->setParams(p);
+		}
+
+		// Parses the face cascade, meant for a background thread (get the
+		// instance on the main thread first). False if it could not be read.
+		bool loadCascade()
+		{
+			return handDetect->loadCascade();
+		}
+
+		bool cascadeReady() const
+		{
+			return handDetect->isCascadeReady();
+		}
+
+		bool cascadeLoaded() const
+		{
+			return handDetect->isCascadeLoaded();
+		}
+
+		// Where to look for the hand first, empty for the whole image
+		void setSearchRegion(const cv::Rect &region)
+		{
+			handDetect->setSearchRegion(region);
+		}
+
 		void findHand() 
 		{
 			if (colorImg.empty() || blobImg.empty())
 			  return;
 			resultImg = handDetect->findHand(colorImg, blobImg);
-			lastHand = handDetect->getLastHand();
+			if(!handDetect->lastHandWasReused())
+				lastHand = handDetect->getLastHand();
 		}
 
 };
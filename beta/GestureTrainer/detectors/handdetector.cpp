@@ -16,21 +16,37 @@ cv::Mat HandDetector::findHand(const cv::Mat colorImg, const cv::Mat binImg)
 {
 	if (binImg.empty() || colorImg.empty())
 	  return cv::Mat();
-	resultImg = colorImg.clone();
+	// the overlays are drawn when the frame is shown (see getFaces), so
+	// the result is the frame itself
+	resultImg = colorImg;
+
+
+	//------------------Held Pose----------------
+	// if the mask around the hand has not changed, the hand and faces
+	// have not either
+	lastHandReused = !lastHand.isNone() && maskChange.unchanged(binImg);
+	if(lastHandReused)
+		return resultImg;
+	//----------------END Held Pose--------------------
 
 
 	//------------------Find Faces----------------
-	//preprocess for face recognition
+	//preprocess for face recognition, once the cascade is loaded
 	std::vector< cv::Rect > faces;
-	cv::Mat gray;
-	//shrink the image for speed
-	cv::resize(resultImg, gray, cv::Size2i(resultImg.cols/4, 
-											resultImg.rows/4));
-	cv::cvtColor(gray, gray, CV_BGR2GRAY);
-	cv::equalizeHist(gray, gray);
-	cascadeFace.detectMultiScale(gray, faces);
-
-	// draw bounds for faces
+	if(isCascadeLoaded())
+	{
+		cv::Mat gray;
+		//shrink the image for speed
+		cv::resize(resultImg, gray, cv::Size2i(resultImg.cols/4, 
+												resultImg.rows/4));
+		// a raw YUV frame's Y plane comes in gray already
+		if(gray.channels() == 3)
+			cv::cvtColor(gray, gray, CV_BGR2GRAY);
+		cv::equalizeHist(gray, gray);
+		cascadeFace.detectMultiScale(gray, faces);
+	}
+
+	// scale the face bounds back up
 	for (unsigned int i = 0; i < faces.size(); i++ )
 	{
 		//resize the rectangle to match the img
@@ -38,14 +54,77 @@ cv::Mat HandDetector::findHand(const cv::Mat colorImg, const cv::Mat binImg)
 		// multiplication is not implemented for sizes...
 		faces[i].width *= 4;
 		faces[i].height *= 5;
-		rectangle(resultImg, faces[i], FACE_COLOR, 3);
 	}
+	lastFaces = faces;
 	//----------------End Faces--------------------
 
 
+	//------------------Find Largest Contour----------------
+	// look in the region the hand was predicted to be in first, then in
+	// the whole frame if it is not there or is cut off by the region
+	cv::Rect frame(0, 0, binImg.cols, binImg.rows);
+	cv::Rect region = searchRegion & frame;
+	std::vector<cv::Point> maxContour;
+
+	if(region.area() > 0 && region != frame)
+	{
+		maxContour = findLargestContour(binImg, region, faces);
+		if(!maxContour.empty() &&
+			clippedBy(cv::boundingRect(maxContour), region, frame))
+			maxContour.clear();
+	}
+
+	if(maxContour.empty())
+		maxContour = findLargestContour(binImg, frame, faces);
+	//----------------END Largest Contour------------------
+
+	if(maxContour.empty())
+	{
+		lastHand = Hand();
+		maskChange.reset();
+	}
+	else
+	{
+		// approxPolyDP(maxContour, maxContour, 2, true);
+
+		// QString str = "find: ";
+		// for(cv::Point c : maxContour)
+		// 	str.append(QString(" (%1, %2) ").arg(c.x).arg(c.y));
+		// qDebug() << str;
+
+		lastHand = Hand(maxContour, params);
+
+		// remember the mask around the hand, padded so a hand moving off
+		// its box shows up as a change
+		cv::Rect box = lastHand.getBoundRect();
+		int pad = std::max(box.width, box.height) / 8;
+		box -= cv::Point(pad, pad);
+		box += cv::Size(2 * pad, 2 * pad);
+		maskChange.store(binImg, box & frame);
+		// lastHand.eliminateWrist(binImg);
+
+
+		// lastHand.draw(resultImg);
+		//------------------END Find Hand--------------------
+	}
+
+	return resultImg;
+}
+
+
+
+/*
+	Finds the largest contour in region of the binary image that does not
+	touch any of the faces. Returns an empty contour if none is at least
+	params.minHandSize. Contour points are in full image coordinates.
+*/
+std::vector<cv::Point> HandDetector::findLargestContour(const cv::Mat &binImg,
+							const cv::Rect &region,
+							const std::vector<cv::Rect> &faces)
+{
 	//------------------Find Contours----------------
-	// find contours in the blob image
-	cv::Mat binImgClone = binImg.clone();
+	// find contours in the blob image (findContours changes its input)
+	cv::Mat binImgClone = binImg(region).clone();
 	std::vector< std::vector<cv::Point> > contours;
 	std::vector<cv::Vec4i> hierarchy;
 	cv::findContours(binImgClone,
@@ -53,29 +132,28 @@ cv::Mat HandDetector::findHand(const cv::Mat colorImg, const cv::Mat binImg)
 					hierarchy, // a hierarchy of contours if there are parent
 								//child relations in the image
 					CV_RETR_EXTERNAL, // retrieve the external contours
-					CV_CHAIN_APPROX_TC89_L1); // an approximation algorithm
+					CV_CHAIN_APPROX_TC89_L1, // an approximation algorithm
+					region.tl()); // shift back to image coordinates
 	//----------------END Contours------------------
 
-	if(contours.size() <= 0)
-		return resultImg;
-
-	//------------------Find Largest Contour----------------
 	int maxMass = 0;
 	std::vector<cv::Point> maxContour;
 
+	if(contours.size() <= 0)
+		return maxContour;
+
 	// iterate through all the top-level contours
 	int idx = 0;
 	for( ; idx >= 0; idx = hierarchy[idx][0] )
 	{
 		// find if current contour intersects with a face
 		bool faceOverlap = false;
-		for(unsigned int i = 0; i < faces.size(); i++)
+		if(!faces.empty())
 		{
-			for(cv::Point p : contours[idx])
-			{
-				if(faces[i].contains(p))
-					faceOverlap = true;
-			}
+			contourPts.assign(contours[idx]);
+			for(unsigned int i = 0; i < faces.size() && !faceOverlap; i++)
+				faceOverlap = anyInRect(contourPts.x.data(), contourPts.y.data(),
+										contourPts.size(), faces[i]);
 		}
 
 		// skip the contour if it intersects with the face
@@ -84,31 +162,25 @@ cv::Mat HandDetector::findHand(const cv::Mat colorImg, const cv::Mat binImg)
 
 		// Find the largest contour
 		int curMass = cv::contourArea( contours[idx] );
-		if(curMass > MIN_HAND_SIZE && curMass > maxMass)
+		if(curMass > params.minHandSize && curMass > maxMass)
 		{
 			maxMass = curMass;
 			maxContour = contours[idx];
 		}
 	}
-	
-	if(maxContour.empty())
-		lastHand = Hand();
-	else
-	{
-		// approxPolyDP(maxContour, maxContour, 2, true);
-
-		// QString str = "find: ";
-		// for(cv::Point c : maxContour)
-		// 	str.append(QString(" (%1, %2) ").arg(c.x).arg(c.y));
-		// qDebug() << str;
-
-		lastHand = Hand(maxContour);
-		// lastHand.eliminateWrist(binImg);
-
 
-		// lastHand.draw(resultImg);
-		//------------------END Find Hand--------------------
-	}
+	return maxContour;
+}
 
-	return resultImg;
+/*
+	True if box runs into a side of region that is not also a side of
+	the frame, i.e. whatever is in box may continue outside the region
+*/
+bool HandDetector::clippedBy(const cv::Rect &box, const cv::Rect &region,
+							const cv::Rect &frame)
+{
+	return (box.x <= region.x && region.x > frame.x)
+		|| (box.y <= region.y && region.y > frame.y)
+		|| (box.br().x >= region.br().x && region.br().x < frame.br().x)
+		|| (box.br().y >= region.br().y && region.br().y < frame.br().y);
 }
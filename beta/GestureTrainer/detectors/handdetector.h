@@ -18,8 +18,12 @@
 
 #include <iostream>
 #include <string>
+#include <atomic>
 
 #include "../include/user.h"
+#include "../include/pointkernels.h"
+#include "../include/maskchange.h"
+#include "../include/detectorparams.h"
 
 // Haar Cascade Classifier face file location
 static std::string FACEFILE = 
@@ -34,25 +38,83 @@ class HandDetector
 {
 
 private:
-	// image containing result of processing
-	// with overlayed hand and face rectangles
+	// image containing result of processing, the color frame (the hand
+	// and face overlays are left to whoever displays it)
 	cv::Mat resultImg;
 
 	// Last resulting Hand
 	Hand lastHand;
 
-	// HAAR Cascade for detecting faces
+	// Whether lastHand was kept from the frame before, and the mask and
+	// faces it was found with
+	bool lastHandReused;
+	MaskChange maskChange;
+	std::vector<cv::Rect> lastFaces;
+
+	// HAAR Cascade for detecting faces, only used once cascadeReady is
+	// set (it may be loading on another thread until then) and
+	// cascadeLoaded says it was read
 	cv::CascadeClassifier cascadeFace;
+	std::atomic<bool> cascadeReady;
+	bool cascadeLoaded;
+
+	// reused buffer for testing contours against the faces
+	PointsSoA contourPts;
+
+	// Region to look for the hand in first, empty for the whole image
+	cv::Rect searchRegion;
+
 
+	// minHandSize here, the rest is passed on to each Hand
+	DetectorParams params;
 
-	static const int MIN_HAND_SIZE = 2000;
+	std::vector<cv::Point> findLargestContour(const cv::Mat &binImg,
+							const cv::Rect &region,
+							const std::vector<cv::Rect> &faces);
+
+	static bool clippedBy(const cv::Rect &box, const cv::Rect &region,
+							const cv::Rect &frame);
 
 
 public:
-	//empty Constructor
-	HandDetector()
+	/*
+		Loads the face cascade right away, or, with loadFaces false,
+		leaves it to a later loadCascade (e.g. on a background thread).
+		Faces are not looked for until it is loaded.
+	*/
+	HandDetector(bool loadFaces = true)
+		: cascadeReady(false), cascadeLoaded(false)
+	{
+		lastHandReused = false;
+		if(loadFaces)
+			loadCascade();
+	}
+
+	/*
+		Parses the face cascade, safe to run on another thread while
+		findHand is used. Returns false if FACEFILE could not be read,
+		faces are then never looked for.
+	*/
+	bool loadCascade()
 	{
-		cascadeFace = cv::CascadeClassifier(FACEFILE);
+		if(cascadeReady)
+			return cascadeLoaded;
+		cascadeLoaded = cascadeFace.load(FACEFILE);
+		// published after cascadeLoaded, which is only read once it is set
+		cascadeReady = true;
+		return cascadeLoaded;
+	}
+
+	// Whether loading the cascade is over, whatever its result
+	bool isCascadeReady() const
+	{
+		return cascadeReady;
+	}
+
+	// Whether the cascade is loaded and faces are looked for
+	bool isCascadeLoaded() const
+	{
+		return cascadeReady && cascadeLoaded;
 	}
 
 	const Hand& getLastHand()
@@ -60,8 +122,44 @@ public:
 		return lastHand;
 	}
 
-	// Uses a binary image of blobs to find a hand and then overlays
-	// rectangles on the face and largest hand
+	// Faces found in the last frame, to draw over it
+	const std::vector<cv::Rect>& getFaces() const
+	{
+		return lastFaces;
+	}
+
+	void setParams(const DetectorParams& p)
+	{
+		params = p;
+	}
+
+	// Forgets the last hand, so the next frame is analysed from scratch
+	// (for unrelated frames, e.g. a dataset)
+	void reset()
+	{
+		lastHand = Hand();
+		lastHandReused = false;
+		maskChange.reset();
+		lastFaces.clear();
+		searchRegion = cv::Rect();
+	}
+
+	// True if the last findHand saw the same mask as the frame before and
+	// kept the hand as it was
+	bool lastHandWasReused() const
+	{
+		return lastHandReused;
+	}
+
+	// Restricts the next search to region (e.g. the tracked hand), the
+	// whole image is still searched if the hand is not found in it
+	void setSearchRegion(const cv::Rect &region)
+	{
+		searchRegion = region;
+	}
+
+	// Uses a binary image of blobs to find a hand, and the faces the
+	// hand is told apart from (in colorImg, BGR or gray)
 	cv::Mat findHand(const cv::Mat colorImg, const cv::Mat blobImg);
 };
 
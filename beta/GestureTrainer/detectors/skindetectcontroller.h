@@ -29,14 +29,20 @@ class SkinDetectController
 
 		SkinDetector *sknDetect;
 
-		// hsvImage storage
+		// hsvImage storage, or convertedImage in the modes that do not
+		// work in HSV, and the color image they came from
 		cv::Mat hsvImage;
+		cv::Mat convertedImage;
+		cv::Mat bgrImage;
 		cv::Mat resultImg;
 
+		SkinMode mode;
+
 	public:
 		SkinDetectController()
 		{
 			sknDetect = new SkinDetector();
+			mode = SKIN_HSV;
 		}
 
 		// Deletes all processor objects created by the controller.
@@ -74,42 +80,74 @@ class SkinDetectController
 		{
 
 			cv::Mat imgIn = cv::imread(filename);
-			// convert color space
-			cv::cvtColor(imgIn, hsvImage, CV_BGR2HSV);
-
-			if (!hsvImage.data)
+			if (!imgIn.data)
 			  return false;
-			else
-			  return true;
+			return setInputImage(imgIn);
 		}
 
-		// Sets the input hsvImage.
+		// Sets the input hsvImage (convertedImage in the other modes).
 		bool setInputImage(cv::Mat imgIn)
 		{
-			// convert color space
-			hsvImage.create(imgIn.rows, imgIn.cols, imgIn.type());
-			cv::cvtColor(imgIn, hsvImage, CV_BGR2HSV);
-
-			if (!hsvImage.data)
+			if (!imgIn.data)
 			  return false;
+			bgrImage = imgIn;
+
+			// convert color space
+			if(usesHSV())
+				cv::cvtColor(imgIn, hsvImage, CV_BGR2HSV);
 			else
-			  return true;
+			{
+				SkinDetector::convert(imgIn, convertedImage, mode);
+				hsvImage.release();
+			}
+			return true;
 		}
 
 		cv::Mat getInputImage()
 		{
-			cv::Mat imgOut;
-			cv::cvtColor(hsvImage, imgOut, CV_HSV2BGR);
-			return imgOut;
+			return bgrImage.clone();
 		}
 
 		// Returns the current input hsvImage.
 		// NOTE: this returns HSV!!!!!
-		const cv::Mat getHSVImage() const 
+		const cv::Mat getHSVImage()
 		{
+			// only converted on demand in the other modes
+			if(hsvImage.empty() && !bgrImage.empty())
+				cv::cvtColor(bgrImage, hsvImage, CV_BGR2HSV);
 			return hsvImage;
 		}
 
+		/*
+			Switches color model, converting the current input again.
+			The histogram model is trained on the first switch to it,
+			from the HSV box mask of the current input.
+		*/
+		void setMode(SkinMode m)
+		{
+			mode = m;
+			if(mode == SKIN_HISTOGRAM && !sknDetect->histogramTrained())
+				trainHistogram();
+			if(!bgrImage.empty())
+				setInputImage(bgrImage);
+		}
+
+		// Trains the histogram model on the current input, false if no skin
+		bool trainHistogram()
+		{
+			if(bgrImage.empty())
+				return false;
+			cv::Mat hsv;
+			cv::cvtColor(bgrImage, hsv, CV_BGR2HSV);
+			cv::Mat mask = sknDetect->processHSV(hsv).clone();
+			return sknDetect->trainHistogram(hsv, mask);
+		}
+
+		SkinMode getMode() const
+		{
+			return mode;
+		}
+
 		const cv::Mat getLastResult() const
 		{
 			return resultImg;
@@ -140,9 +178,27 @@ class SkinDetectController
 			sknDetect->setBlur(set);
 		}
 
+		void setParams(const DetectorParams& p)
+		{
+			sknDetect->setParams(p);
+		}
+
 		void process() 
 		{
-			resultImg = sknDetect->processHSV(hsvImage);
+			resultImg = sknDetect->process(usesHSV() ? hsvImage : convertedImage,
+											mode);
+		}
+
+		// Thresholds a raw YUV 4:2:0 frame directly (SKIN_YCRCB ranges)
+		void processYUV(const cv::Mat &raw, bool nv12)
+		{
+			resultImg = sknDetect->processYUV(raw, nv12);
+		}
+
+	private:
+		bool usesHSV() const
+		{
+			return mode == SKIN_HSV || mode == SKIN_HISTOGRAM;
 		}
 
 };
@@ -7,10 +7,13 @@
 
 	This class uses holds input threshold min and max
 	masks to process an image for skin blobs in HSV colorspace
+	(and the other color models of skinmodels.h)
 */
 
 #include "skindetector.h"
-#include "../include/colorhistogram.h"
+
+#include <algorithm>
+#include <cmath>
 
 /*
 	Processes an HSV image and returns a binary image
@@ -27,21 +30,214 @@ cv::Mat SkinDetector::processHSV(const cv::Mat &hsvImg)
 	//same cols and rows as original
 	resultImg.create(hsvImg.rows, hsvImg.cols, CV_8U);
 
-	//reduce the colors for faster processing
-	// ColorHistogram h;
-	// h.colorReduce(hsvImg, 12);
+	//threshold the image with the stored masks
+	segmentSkin(reduce(hsvImg), HSVBoxModel(hsvThreshold[0], hsvThreshold[1]),
+				resultImg);
 
-	cv::Mat morphImg;
-	cv::GaussianBlur(hsvImg, morphImg, cv::Size(11,11), 0);
-	cv::medianBlur(morphImg, morphImg, 11);
+	return filter();
+}
 
-	//threshold the image with the stored masks
-	cv::inRange(hsvImg, hsvThreshold[0], hsvThreshold[1], resultImg);
+/*
+	Same as processHSV for a YCrCb image, with the YCrCb range
+*/
+cv::Mat SkinDetector::processYCrCb(const cv::Mat &ycrcbImg)
+{
+	segmentSkin(reduce(ycrcbImg),
+				YCrCbBoxModel(ycrcbThreshold[0], ycrcbThreshold[1]), resultImg);
+	return filter();
+}
+
+cv::Mat SkinDetector::process(const cv::Mat &image, SkinMode mode)
+{
+	switch(mode)
+	{
+		case SKIN_YCRCB:
+			return processYCrCb(image);
+		case SKIN_RG:
+			segmentSkin(reduce(image), RGModel(rgThreshold[0], rgThreshold[1]),
+						resultImg);
+			return filter();
+		case SKIN_HISTOGRAM:
+			// untrained, nothing is skin
+			if(histTable.empty())
+			{
+				resultImg.create(image.rows, image.cols, CV_8U);
+				resultImg.setTo(cv::Scalar(0));
+				return resultImg;
+			}
+			segmentSkin(reduce(image), HistogramModel(&histTable[0]), resultImg);
+			return filter();
+		default:
+			return processHSV(image);
+	}
+}
+
+cv::Mat SkinDetector::processBGR(const cv::Mat &bgrImg, SkinMode mode)
+{
+	convert(bgrImg, converted, mode);
+	return process(converted, mode);
+}
+
+void SkinDetector::convert(const cv::Mat &bgrImg, cv::Mat &out, SkinMode mode)
+{
+	int code;
+	switch(mode)
+	{
+		case SKIN_YCRCB:
+			code = YCrCbBoxModel::CONVERSION;
+			break;
+		case SKIN_RG:
+			code = RGModel::CONVERSION;
+			break;
+		case SKIN_HISTOGRAM:
+			code = HistogramModel::CONVERSION;
+			break;
+		default:
+			code = HSVBoxModel::CONVERSION;
+	}
+
+	if(code < 0)
+		out = bgrImg;
+	else
+		cv::cvtColor(bgrImg, out, code);
+}
+
+/*
+	Counts the hue/saturation bins of the masked pixels, and takes the
+	bins holding at least HIST_MIN_SHARE of the fullest as skin
+*/
+bool SkinDetector::trainHistogram(const cv::Mat &hsvImg, const cv::Mat &mask)
+{
+	const int bins = HistogramModel::BINS;
+	const float HIST_MIN_SHARE = 0.05f;
+
+	std::vector<int> counts(bins * bins, 0);
+	for(int r = 0; r < hsvImg.rows; r++)
+	{
+		const uchar *p = hsvImg.ptr<uchar>(r), *m = mask.ptr<uchar>(r);
+		for(int c = 0; c < hsvImg.cols; c++, p += 3)
+			if(m[c])
+				counts[HistogramModel::bin(p)]++;
+	}
 
+	int fullest = *std::max_element(counts.begin(), counts.end());
+	if(fullest == 0)
+		return false;
+
+	histTable.resize(bins * bins);
+	for(int i = 0; i < bins * bins; i++)
+		histTable[i] = counts[i] >= HIST_MIN_SHARE * fullest ? 1 : 0;
+	return true;
+}
+
+/*
+	Same for a raw YUV 4:2:0 frame, without converting it. The chroma
+	planes are thresholded at their quarter size and scaled up, then
+	and'ed with the luma mask. Camera YUV is usually limited range
+	(16-235) where OpenCV's YCrCb is full range, the converted ranges are
+	close enough for skin but may need widening.
+*/
+cv::Mat SkinDetector::processYUV(const cv::Mat &raw, bool nv12)
+{
+	const int rows = raw.rows * 2 / 3, cols = raw.cols;
+	const cv::Scalar &lo = ycrcbThreshold[0], &hi = ycrcbThreshold[1];
+
+	// chroma is a quarter of the pixels, threshold it first at its size
+	uchar *chroma = const_cast<uchar*>(raw.ptr<uchar>(rows));
+	if(nv12)
+	{
+		// interleaved Cb, Cr
+		cv::Mat uv(rows / 2, cols / 2, CV_8UC2, chroma, raw.step);
+		cv::inRange(uv, cv::Scalar(lo[2], lo[1]), cv::Scalar(hi[2], hi[1]),
+					chromaMask);
+	}
+	else
+	{
+		// a Cb plane then a Cr plane, each rows / 2 by cols / 2
+		cv::Mat u(rows / 2, cols / 2, CV_8UC1, chroma);
+		cv::Mat v(rows / 2, cols / 2, CV_8UC1, chroma + u.total());
+		cv::inRange(u, lo[2], hi[2], chromaMask);
+		cv::inRange(v, lo[1], hi[1], vMask);
+		chromaMask &= vMask;
+	}
+	cv::resize(chromaMask, resultImg, cv::Size(cols, rows), 0, 0,
+				cv::INTER_NEAREST);
+
+	cv::Mat y(rows, cols, CV_8UC1, const_cast<uchar*>(raw.data), raw.step);
+	cv::inRange(y, lo[0], hi[0], lumaMask);
+	resultImg &= lumaMask;
+
+	return filter();
+}
+
+/*
+	Converts a grid of 16 steps per channel over the HSV box to YCrCb
+	and rg and returns the boxes around the results
+*/
+void SkinDetector::convertRange(const cv::Scalar &hsvMin, const cv::Scalar &hsvMax,
+								cv::Scalar ycrcb[2], cv::Scalar rg[2])
+{
+	// a grid over the box, its edges included
+	const int steps = 16;
+	cv::Mat hsv(1, steps * steps * steps, CV_8UC3), bgr, ycrcbImg;
+	cv::Vec3b *p = hsv.ptr<cv::Vec3b>(0);
+	for(int h = 0; h < steps; h++)
+		for(int s = 0; s < steps; s++)
+			for(int v = 0; v < steps; v++)
+				*p++ = cv::Vec3b(
+					cv::saturate_cast<uchar>(hsvMin[0] + (hsvMax[0] - hsvMin[0]) * h / (steps - 1)),
+					cv::saturate_cast<uchar>(hsvMin[1] + (hsvMax[1] - hsvMin[1]) * s / (steps - 1)),
+					cv::saturate_cast<uchar>(hsvMin[2] + (hsvMax[2] - hsvMin[2]) * v / (steps - 1)));
+
+	cv::cvtColor(hsv, bgr, CV_HSV2BGR);
+	cv::cvtColor(bgr, ycrcbImg, CV_BGR2YCrCb);
+
+	std::vector<cv::Mat> planes;
+	cv::split(ycrcbImg, planes);
+	for(int c = 0; c < 3; c++)
+	{
+		double lo, hi;
+		cv::minMaxLoc(planes[c], &lo, &hi);
+		ycrcb[0][c] = lo;
+		ycrcb[1][c] = hi;
+	}
+
+	rg[0] = cv::Scalar(255, 255);
+	rg[1] = cv::Scalar(0, 0);
+	const uchar *b = bgr.ptr<uchar>(0);
+	for(int i = 0; i < steps * steps * steps; i++, b += 3)
+	{
+		float r, g;
+		RGModel::toRG(b, r, g);
+		rg[0][0] = std::min<double>(rg[0][0], r);
+		rg[1][0] = std::max<double>(rg[1][0], r);
+		rg[0][1] = std::min<double>(rg[0][1], g);
+		rg[1][1] = std::max<double>(rg[1][1], g);
+	}
+	// widened to whole values, RGModel rounds its bounds inwards
+	for(int c = 0; c < 2; c++)
+	{
+		rg[0][c] = std::floor(rg[0][c]);
+		rg[1][c] = std::ceil(rg[1][c]);
+	}
+}
+
+const cv::Mat& SkinDetector::reduce(const cv::Mat &image)
+{
+	//optionally reduce the colors first, into a buffer kept between frames
+	if(params.colorReduce <= 1)
+		return image;
+	reducer.colorReduce(image, reducedImg, params.colorReduce);
+	return reducedImg;
+}
+
+cv::Mat SkinDetector::filter()
+{
 	//filtering parameter, increase size for greater effect
 	// cv::Mat morpElement(5,5,CV_8U,cv::Scalar(1));
-	cv::Mat morpElement = 
-		cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5,5), cv::Point(4,4));
+	int size = std::max(params.morphSize, 1);
+	cv::Mat morpElement = cv::getStructuringElement(cv::MORPH_RECT,
+						cv::Size(size, size), cv::Point(size - 1, size - 1));
 
 	//current morphological processing functions to 
 	//close the skin blobs
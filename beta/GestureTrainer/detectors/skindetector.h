@@ -7,6 +7,15 @@
 
 	This class uses holds input threshold min and max
 	masks to process an image for skin blobs in HSV colorspace
+
+	It can also threshold YCrCb, either a converted image or the Y and
+	chroma planes of a raw YUV 4:2:0 frame as cameras deliver it, which
+	skips the conversion to HSV (and, in the app, the one to BGR on frames
+	that are not shown), or normalized
+	rg, or back-project a trained hue/saturation histogram (see
+	skinmodels.h). The YCrCb and rg ranges are converted from the HSV one
+	(see convertRange), so the same presets and sliders work in every
+	mode.
 */
 
 #if !defined SKINDETECT
@@ -16,6 +25,11 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <iostream>
 
+#include "../include/detectorparams.h"
+#include "../include/colorhistogram.h"
+#include "skinmodels.h"
+
+#include <vector>
 
 
 class SkinDetector
@@ -26,15 +40,33 @@ class SkinDetector
 		// HSV min and max limits as array of Scalars
         cv::Scalar hsvThreshold[2];
 
+		// the same range in YCrCb and normalized rg, kept in step with
+		// hsvThreshold
+		cv::Scalar ycrcbThreshold[2];
+		cv::Scalar rgThreshold[2];
+
+		// HistogramModel's table, empty until trained
+		std::vector<uchar> histTable;
+
+		// chroma and luma masks of a raw YUV frame
+		cv::Mat chromaMask, lumaMask, vMask;
+
 		// image containing result of processing
 		cv::Mat resultImg;
 
 		// image containing converted color space
 		cv::Mat converted;
 
+		// the HSV image with its colors reduced, and what reduces them
+		cv::Mat reducedImg;
+		ColorHistogram reducer;
+
 		// bools for morphological filtering
 		bool invert, erode, dilate, blur;
 
+		// morphSize and colorReduce are used here
+		DetectorParams params;
+
 
 	public:
 		//empty Constructor
@@ -49,6 +81,8 @@ class SkinDetector
 			hsvThreshold[1][2] = 255;
             erode = dilate = blur =  true;
             invert = false;
+			convertRange(hsvThreshold[0], hsvThreshold[1],
+						ycrcbThreshold, rgThreshold);
 		}
 
 		void setInvert(bool set)
@@ -91,17 +125,78 @@ class SkinDetector
 		{
 			hsvThreshold[0] = min;
 			hsvThreshold[1] = max;
+			convertRange(min, max, ycrcbThreshold, rgThreshold);
 			//std::cout << "min: " << min << "\t" << "max" << max << "\n";
 		}
 
+		void getYCrCbThreshold(cv::Scalar &min, cv::Scalar &max)
+		{
+			min = ycrcbThreshold[0];
+			max = ycrcbThreshold[1];
+		}
+
 		void getThreshold(cv::Scalar &min, cv::Scalar &max)
 		{
 			min = hsvThreshold[0];
 			max = hsvThreshold[1];
 		}
 
+		void setParams(const DetectorParams& p)
+		{
+			params = p;
+		}
+
 		// Processes an already HSV image. Returns a 1-channel binary image.
 		cv::Mat processHSV(const cv::Mat &image);
+
+		// Same for a YCrCb image
+		cv::Mat processYCrCb(const cv::Mat &image);
+
+		/*
+			Same for an image converted for mode (see convert), with
+			that mode's model. The model is picked here, once per image.
+		*/
+		cv::Mat process(const cv::Mat &image, SkinMode mode);
+
+		// Same from a BGR image, converted into a buffer kept between frames
+		cv::Mat processBGR(const cv::Mat &bgrImg, SkinMode mode);
+
+		/*
+			Same for a raw YUV 4:2:0 frame (height * 3/2 rows, see
+			RawYUVSource), thresholding its planes where they are. nv12
+			is false for I420.
+		*/
+		cv::Mat processYUV(const cv::Mat &raw, bool nv12);
+
+		/*
+			Trains the histogram mode on the pixels of an HSV image under
+			mask (e.g. the HSV box mask of a frame with a hand in it).
+			Returns false if there were none.
+		*/
+		bool trainHistogram(const cv::Mat &hsvImg, const cv::Mat &mask);
+
+		bool histogramTrained() const
+		{
+			return !histTable.empty();
+		}
+
+		// Converts a BGR image to the color space of mode's model
+		static void convert(const cv::Mat &bgrImg, cv::Mat &out, SkinMode mode);
+
+		/*
+			The YCrCb and normalized rg boxes holding every color of the
+			HSV box (sampled over it, they are larger than the HSV one in
+			general)
+		*/
+		static void convertRange(const cv::Scalar &hsvMin, const cv::Scalar &hsvMax,
+								cv::Scalar ycrcb[2], cv::Scalar rg[2]);
+
+	private:
+		// the optional color reduction of processHSV and processYCrCb
+		const cv::Mat& reduce(const cv::Mat &image);
+
+		// morphological filtering of resultImg shared by every mode
+		cv::Mat filter();
 };
 
 #endif
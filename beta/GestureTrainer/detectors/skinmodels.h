@@ -0,0 +1,173 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	The skin color models SkinDetector can threshold with, as policies for
+	the segmentSkin template: each says which color space it works in
+	(CONVERSION, -1 for BGR as it is) and tests one pixel of it. The test
+	is inlined into the loop over the image, so every model gets its own
+	specialized loop and nothing is decided per pixel.
+
+		HSVBoxModel			a box in HSV (the original detector)
+		YCrCbBoxModel		a box in YCrCb
+		RGModel				a box in normalized red and green, r = R/(R+G+B)
+							and g = G/(R+G+B), scaled to 0-255, which
+							ignores brightness
+		HistogramModel		back-projection of a hue/saturation histogram
+							trained on skin pixels, any shape of region
+
+*/
+
+
+#ifndef SKINMODELS_H
+#define SKINMODELS_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+enum SkinMode {
+	SKIN_HSV,
+	SKIN_YCRCB,
+	SKIN_RG,
+	SKIN_HISTOGRAM
+};
+
+inline const char* skinModeName(SkinMode mode)
+{
+	switch(mode)
+	{
+		case SKIN_YCRCB:
+			return "YCrCb";
+		case SKIN_RG:
+			return "normalized rg";
+		case SKIN_HISTOGRAM:
+			return "histogram";
+		default:
+			return "HSV";
+	}
+}
+
+
+// A box over three 8 bit channels, bounds included
+struct BoxModel
+{
+	uchar lo[3], hi[3];
+
+	BoxModel(const cv::Scalar &min, const cv::Scalar &max)
+	{
+		for(int c = 0; c < 3; c++)
+		{
+			// as cv::inRange rounds them
+			lo[c] = cv::saturate_cast<uchar>(cvCeil(min[c]));
+			hi[c] = cv::saturate_cast<uchar>(cvFloor(max[c]));
+		}
+	}
+
+	bool operator()(const uchar *p) const
+	{
+		return (p[0] >= lo[0]) & (p[0] <= hi[0]) &
+				(p[1] >= lo[1]) & (p[1] <= hi[1]) &
+				(p[2] >= lo[2]) & (p[2] <= hi[2]);
+	}
+};
+
+struct HSVBoxModel : BoxModel
+{
+	static const int CONVERSION = CV_BGR2HSV;
+
+	HSVBoxModel(const cv::Scalar &min, const cv::Scalar &max)
+		: BoxModel(min, max) {}
+};
+
+struct YCrCbBoxModel : BoxModel
+{
+	static const int CONVERSION = CV_BGR2YCrCb;
+
+	YCrCbBoxModel(const cv::Scalar &min, const cv::Scalar &max)
+		: BoxModel(min, max) {}
+};
+
+
+// min and max are (r, g) in their first two values, on a 0-255 scale
+struct RGModel
+{
+	static const int CONVERSION = -1;
+
+	int rLo, rHi, gLo, gHi;
+
+	RGModel(const cv::Scalar &min, const cv::Scalar &max)
+		: rLo(cvCeil(min[0])), rHi(cvFloor(max[0])),
+		gLo(cvCeil(min[1])), gHi(cvFloor(max[1])) {}
+
+	// r in [rLo, rHi] is rLo * sum <= 255 * R <= rHi * sum, no division
+	// (black has no chromaticity and is never skin)
+	bool operator()(const uchar *p) const
+	{
+		const int sum = p[0] + p[1] + p[2], r = 255 * p[2], g = 255 * p[1];
+		return (sum > 0) & (r >= rLo * sum) & (r <= rHi * sum) &
+				(g >= gLo * sum) & (g <= gHi * sum);
+	}
+
+	// Normalized (r, g) of a BGR color, on a 0-255 scale
+	static void toRG(const uchar *bgr, float &r, float &g)
+	{
+		const int sum = bgr[0] + bgr[1] + bgr[2];
+		r = sum ? 255.0f * bgr[2] / sum : 0;
+		g = sum ? 255.0f * bgr[1] / sum : 0;
+	}
+};
+
+
+// table is BINS x BINS of hue x saturation, nonzero where skin
+struct HistogramModel
+{
+	static const int CONVERSION = CV_BGR2HSV;
+	static const int BINS = 32;
+
+	const uchar *table;
+
+	explicit HistogramModel(const uchar *t) : table(t) {}
+
+	bool operator()(const uchar *p) const
+	{
+		return table[bin(p)] != 0;
+	}
+
+	// Index of an HSV pixel's bin in the table
+	static int bin(const uchar *p)
+	{
+		// hue is 0-179, but colorReduce can round it up to 184, which is
+		// kept in the last bin; saturation is 0-255
+		const int h = p[0] * BINS / 180;
+		return (h < BINS ? h : BINS - 1) * BINS + (p[1] * BINS >> 8);
+	}
+};
+
+
+/*
+	Writes 255 into mask where model takes the pixel of image (already in
+	the model's color space) as skin, 0 elsewhere
+*/
+template<class Model>
+void segmentSkin(const cv::Mat &image, const Model &model, cv::Mat &mask)
+{
+	mask.create(image.rows, image.cols, CV_8U);
+
+	int rows = image.rows, cols = image.cols;
+	if(image.isContinuous() && mask.isContinuous())
+	{
+		cols *= rows;
+		rows = 1;
+	}
+
+	for(int r = 0; r < rows; r++)
+	{
+		const uchar *p = image.ptr<uchar>(r);
+		uchar *m = mask.ptr<uchar>(r);
+		for(int c = 0; c < cols; c++, p += 3)
+			m[c] = model(p) ? 255 : 0;
+	}
+}
+
+#endif
@@ -26,9 +26,13 @@
 //##############################################################################
 //  Constructors / Destructor
 
-MainWindow::MainWindow(QWidget *parent) :
+MainWindow::MainWindow(QWidget *parent, const std::string &source) :
 	QMainWindow(parent),
-	ui(new Ui::MainWindow)
+	ui(new Ui::MainWindow),
+	sourceSpec(source),
+	source(0),
+	yuvSource(0),
+	rawFrame(false)
 {
 	// setup and display form
 	ui->setupUi(this);
@@ -66,66 +70,76 @@ MainWindow::MainWindow(QWidget *parent) :
 
 
 	//set up video ------------------
-	//get camera
-	cap.open(CAMERA);
-	// check if we succeeded, if not do not enable camera toggle
-	if(!cap.isOpened())
-		ui->pushButton_Camera->setEnabled(false);
+	// the camera, the face cascade and the location presets load on other
+	// threads, the form is usable meanwhile. The camera toggle is enabled
+	// once the camera opens.
+	startupClock.start();
+	cameraMs = cascadeMs = presetsMs = firstFrameMs = -1;
+	cameraReady = benchmarking = false;
+	ui->pushButton_Camera->setEnabled(false);
+
+	connect(&cameraWatcher, SIGNAL(finished()), this, SLOT(cameraOpened()));
+	connect(&cascadeWatcher, SIGNAL(finished()), this, SLOT(cascadeLoaded()));
+	connect(&presetWatcher, SIGNAL(finished()), this, SLOT(presetsLoaded()));
+
+	// the singleton is made here, not on the loading thread
+	HandDetectController *hands = HandDetectController::getInstance();
+	cameraWatcher.setFuture(QtConcurrent::run(this, &MainWindow::openCamera));
+	cascadeWatcher.setFuture(QtConcurrent::run(hands,
+										&HandDetectController::loadCascade));
+	presetWatcher.setFuture(QtConcurrent::run(&MainWindow::readLocations,
+										LOC_PREFS));
 	//end setup video ---------------
 
 
 	//default settings
 	backProcess = histEnable = handDetect = measureHand = false;
+	showOverlays = true;
+	scheduler.setRate(DISPLAY_HZ);
+	datasetUser = -1;
+	datasetFrames = 0;
+	goalStartMs = 0;
+	frameMs = 0;
 	user.setLeft(false);
 	cHist = ColorHistogram();
 
-	//Environments
-	QFile file(LOC_PREFS.c_str());
-	bool ret = file.open(QIODevice::ReadOnly | QIODevice::Text);
-//    qDebug() << QDir::currentPath();
-	if( ret )
+	// trained gesture model, the hardcoded rules are used without one
+	// (kiosk builds have it compiled in instead)
+#ifndef GESTURE_COMPILED_MODEL
+	if(!user.loadModel(GESTURE_MODEL))
+		qDebug() << "No gesture model, using hardcoded classes";
+#endif
+
+	// detector tuning, as found by gesturesweep, defaults without
+	if(params.load(DETECTOR_PREFS))
 	{
-		QTextStream stream(&file);
-		while(!stream.atEnd())
-		{
-			QString line = stream.readLine();
-			if(line.size() < 10)
-				continue;
-//            qDebug() << line;
-			QStringList strList = line.split("#", QString::SkipEmptyParts);
-			std::vector<cv::Scalar> loc = {cv::Scalar(), cv::Scalar()};
-
-//            qDebug() << strList;
-			locationNames.push_back(strList.at(0));
-			loc[0][0] = strList.at(1).toInt();
-			loc[0][1] = strList.at(2).toInt();
-			loc[0][2] = strList.at(3).toInt();
-			loc[1][0] = strList.at(4).toInt();
-			loc[1][1] = strList.at(5).toInt();
-			loc[1][2] = strList.at(6).toInt();
-			locations.push_back(loc);
-		}
+		SkinDetectController::getInstance()->setParams(params);
+		HandDetectController::getInstance()->setParams(params);
 	}
 
-//	std::vector<cv::Scalar> home = {cv::Scalar(0, 40, 93), cv::Scalar(20, 255, 255)};
-//	locations.push_back(home);
-//	locationNames.push_back("Home");
-
-	//Hardcoded default HSV filter for home environment
-	min = locations[0][0];
-	max = locations[0][1];
-	setSliders();
-
-	for(unsigned int i = 0; i <locationNames.size(); i++)
-		ui->comboBox->addItem(locationNames[i]);
+	// the last trainee is loaded with the presets, see presetsLoaded
+	profiles.open(PROFILE_DIR);
 }
 
 MainWindow::~MainWindow()
 {
+	// the loading threads use the camera and detector
+	cameraWatcher.waitForFinished();
+	cascadeWatcher.waitForFinished();
+	presetWatcher.waitForFinished();
+
+	delete source;
 	delete ui;
 	delete timer;
 }
 
+void MainWindow::benchmarkStartup()
+{
+	benchmarking = true;
+	if(cameraReady)
+		cameraOpened();
+}
+
 //  END Constructors / Destructor
 //##############################################################################
 
@@ -136,30 +150,14 @@ MainWindow::~MainWindow()
 
 /*
 	A simple conversion method to display a cv::Mat image (BGR or binary)
-	in a QLabel, that only takes a QImage as a pixelmap.
+	in a QLabel, that only takes a QImage as a pixelmap. Every label has
+	its own buffers, reused from frame to frame.
 */
 void MainWindow::displayMat(const cv::Mat image, QLabel *label)
 {
-	//BGR openCV Mat to QImage
-	QImage img_qt = QImage((const unsigned char*)image.data,image.cols,
-							image.rows, image.step, QImage::Format_RGB888);
-
-	//For Binary Images
-	if (img_qt.isNull())
-	{
-		//ColorTable for Binary Images
-		QVector<QRgb> colorTable;
-		for (int i = 0; i < 256; i++)
-			colorTable.push_back(qRgb(i, i, i));
-
-		img_qt = QImage((const unsigned char*)image.data,image.cols, 
-							image.rows, image.step, QImage::Format_Indexed8);
-		img_qt.setColorTable(colorTable);
-	}
-
-	//Display the QImage in the Label
-	QPixmap img_pix = QPixmap::fromImage(img_qt.rgbSwapped()); //BGR to RGB
-	label->setPixmap(img_pix.scaled(label->size(), Qt::KeepAspectRatio));
+	const QImage& img_qt = displays[label].convert(image, label->size());
+	if(!img_qt.isNull())
+		label->setPixmap(QPixmap::fromImage(img_qt));
 }
 
 /*
@@ -168,15 +166,25 @@ void MainWindow::displayMat(const cv::Mat image, QLabel *label)
 */
 cv::Mat MainWindow::processSkin( const cv::Mat img )
 {
+	SkinDetectController *skin = SkinDetectController::getInstance();
+
+	// a raw YUV frame is thresholded as it is, not converted
+	if(rawFrame)
+	{
+		skin->processYUV(yuvSource->getRaw(),
+						yuvSource->getLayout() == RawYUVSource::NV12);
+		return skin->getLastResult();
+	}
+
 	//send SkinDetector the frame
-	bool set = SkinDetectController::getInstance()->setInputImage(img);
+	bool set = skin->setInputImage(img);
 	if (!set)
 		qDebug() << "Image not set!!!!!";
 	//process the frame
-	SkinDetectController::getInstance()->process();
+	skin->process();
 	
 	//retrieve the processed frame
-	cv::Mat result = SkinDetectController::getInstance()->getLastResult();  
+	cv::Mat result = skin->getLastResult();  
 	return result;
 }
 
@@ -191,16 +199,39 @@ cv::Mat MainWindow::processHand( const cv::Mat color, const cv::Mat binary )
 	if (!set)
 		qDebug() << "Images not set!!!!!";
 
-	// find the hand blob and store
+	// find the hand blob near where the user's hand is heading, and store
+	HandDetectController::getInstance()->setSearchRegion(user.predictedROI());
 	HandDetectController::getInstance()->findHand();
 
+	// a held pose keeps the user's hand and class from the last frame
+	if(!HandDetectController::getInstance()->lastHandReused())
+		user.setCurHand(HandDetectController::getInstance()->getLastHand());
+
 	// display hand ROI in small window
-	user.setCurHand(HandDetectController::getInstance()->getLastHand());
-	cv::namedWindow("fingerIMG");
-	cv::Mat handDrawing = user.curHand.findFingers();
-	cv::imshow("fingerIMG", handDrawing);
-	return user.curHand.draw(
-				HandDetectController::getInstance()->getLastResult());
+	if(scheduler.windows())
+	{
+		cv::namedWindow("fingerIMG");
+		cv::Mat handDrawing = user.curHand.drawFingers();
+		cv::imshow("fingerIMG", handDrawing);
+	}
+
+	// the overlays are drawn by drawOverlays, only on frames that are shown
+	return HandDetectController::getInstance()->getLastResult();
+}
+
+/*
+	Draws the faces, hand and motion trail found in the last processed
+	frame over img, unless overlays are turned off ('o').
+*/
+void MainWindow::drawOverlays( cv::Mat img )
+{
+	if(!showOverlays || img.empty())
+		return;
+
+	for(const cv::Rect& face : HandDetectController::getInstance()->getLastFaces())
+		cv::rectangle(img, face, FACE_COLOR, 3);
+	user.curHand.draw(img, overlayBuffer);
+	user.drawTrajectory(img);
 }
 
 /*
@@ -214,7 +245,7 @@ cv::Mat MainWindow::detectHand( const cv::Mat img )
 	cv::Mat result = processHand(img, binary);
 
 	// display hand ROI in small window
-	if(!user.curHand.isNone())
+	if(!user.curHand.isNone() && scheduler.showing())
 	{
 		cv::Mat handROI(img, user.curHand.getBoundRect());
 		if(handROI.data)
@@ -226,8 +257,18 @@ cv::Mat MainWindow::detectHand( const cv::Mat img )
 //										.arg(user.fist.getB())
 //                                        .arg(user.spread.getB()));
 
-		ui->textBrowser->setText(user.getData());
-		ui->textBrowser->append(user.curHand.getData());
+		MotionType motion = user.recentMotion();
+		if(scheduler.stats())
+		{
+			ui->textBrowser->setText(user.getData());
+			ui->textBrowser->append(user.curHand.getData());
+			if(motion != MOTION_NONE)
+				ui->textBrowser->append(QString("Motion: %1")
+											.arg(motionName(motion)));
+		}
+		else if(motion != MOTION_NONE)
+			ui->textBrowser->setText(QString("Motion: %1")
+										.arg(motionName(motion)));
 	}
 
 	return result;
@@ -248,7 +289,11 @@ cv::Mat MainWindow::measureHands( const cv::Mat img )
 	cv::Mat capROI(img, captureRect);
 	cv::Mat binCapROI = processSkin(capROI);
 	capROI = processHand(capROI, binCapROI);
-	displayMat(capROI, ui->label_Train);
+	if(scheduler.showing())
+	{
+		drawOverlays(capROI);
+		displayMat(capROI, ui->label_Train);
+	}
 
 
 	return result;
@@ -256,58 +301,293 @@ cv::Mat MainWindow::measureHands( const cv::Mat img )
 
 cv::Mat MainWindow::trainUser(cv::Mat img)
 {
+	// the untouched frame, in case it is recorded
+	cv::Mat frame;
+	if(featureLog.isOpen())
+		frame = img.clone();
+
 	cv::Mat binary = processSkin(img);
 	cv::Mat result = processHand(img, binary);
 
+	// every frame votes, no hand counts against the goal too
+	double now = frameMs;
+	voter.vote(user.curHand.isNone() ? NONE : user.curHand.type, now);
+
 	if( user.curHand.isNone() )
 		return img;
-    else if ( user.curHand.getType().toStdString() == curGoalSet.back())
+
+	logFeatures(curGoalSet.back());
+	recordFrame(frame, curGoalSet.back());
+
+	if(voter.recognized() == curType)
 	{
-		numSuccesses++;
-		if(numSuccesses >= 10)
+		//VICTORY
+		double elapsed = now - goalStartMs;
+		recordRecognition(curGoalSet.back(), elapsed);
+
+		QString str = QString("\nSuccess, you have shown the letter %1"
+							" in %2 seconds.")
+				.arg(curGoalSet.back().c_str())
+				.arg(elapsed / 1000, 0, 'f', 2);
+		ui->feedbackBrowser->append(str);
+
+		curGoalSet.pop_back();
+
+		if(curGoalSet.empty())
 		{
-			//VICTORY
-            QString str = QString("\nSuccess, you have shown the letter %1.")
-                    .arg(curGoalSet.back().c_str());
-			ui->feedbackBrowser->append(str);
-			numSuccesses = 0;
-			
-            curGoalSet.pop_back();
+			// Training is done
+			str = QString("Congratulations, you have finished the training"
+						" corpus. Press the training button to begin again"
+						" or step aside and let someone else train.\n");
+			ui->feedbackBrowser->setText(str);
 
-			if(curGoalSet.empty())
+			// how long each gesture took to recognize this session
+			for(const auto& times : recognitionTimes)
 			{
-				// Training is done
-				str = QString("Congratulations, you have finished the training"
-							" corpus. Press the training button to begin again"
-							" or step aside and let someone else train.");
-                ui->feedbackBrowser->setText(str);
-                on_pushButton_Training_clicked();
-				return img;
+				double sum = 0;
+				for(double ms : times.second)
+					sum += ms;
+				ui->feedbackBrowser->append(QString("%1: %2 s on average")
+						.arg(times.first.c_str())
+						.arg(sum / times.second.size() / 1000, 0, 'f', 2));
 			}
+			recognitionTimes.clear();
 
+			on_pushButton_Training_clicked();
+			return img;
+		}
 
-			std::string gesture = curGoalSet.back();
-			curType = Hand::translateType(gesture);
+		showNextGoal();
+	}
 
-            str = QString::fromStdString(goalDir +
-							gesture + imgExtension);
-			// qDebug() << str;
+	return img;
+}
 
-			QPixmap img_pix(str);
-			ui->label_Goal->setPixmap(img_pix.scaled(
-					ui->label_Goal->size(), Qt::KeepAspectRatio));
+/*
+	Keeps how long a goal gesture took to be recognized, and appends it
+	to the recognition log (gesture#ms) so it can be tracked over time
+*/
+void MainWindow::recordRecognition(const std::string& gesture, double ms)
+{
+	recognitionTimes[gesture].push_back(ms);
 
-		}
-		//CONTINUATION
+	QFile log(RECOGNITION_LOG.c_str());
+	if(log.open(QIODevice::Append | QIODevice::Text))
+	{
+		QTextStream out(&log);
+		out << gesture.c_str() << "#" << ms << "\n";
 	}
-	else
+}
+
+/*
+	Shows the goal gesture at the back of the set and starts timing it
+*/
+void MainWindow::showNextGoal()
+{
+	std::string gesture = curGoalSet.back();
+	curType = Hand::translateType(gesture);
+
+	QString str = QString::fromStdString(goalDir + gesture + imgExtension);
+	QPixmap img_pix(str);
+	ui->label_Goal->setPixmap(img_pix.scaled(
+			ui->label_Goal->size(), Qt::KeepAspectRatio));
+
+	voter.reset();
+	goalStartMs = frameMs;
+}
+
+/*
+	Appends the current hand's feature vector, labelled with the goal
+	gesture, to the feature log if it is open. One sample per line:
+	label#f0#f1#...
+*/
+void MainWindow::logFeatures(const std::string& label)
+{
+	if(!featureLog.isOpen())
+		return;
+
+	float calib[5], x[GESTURE_FEATURES];
+	user.calibratedAngles(calib);
+	gestureFeatures(user.curFeatures, calib, user.isLeft(), x);
+
+	QTextStream out(&featureLog);
+	out << label.c_str();
+	for(int i = 0; i < GESTURE_FEATURES; i++)
+		out << "#" << x[i];
+	out << "\n";
+}
+
+/*
+	Saves the frame into the dataset, labelled with the goal gesture, if
+	recording is on
+*/
+void MainWindow::recordFrame(const cv::Mat& frame, const std::string& label)
+{
+	if(frame.empty() || datasetUser < 0)
+		return;
+
+	DatasetFrame entry;
+	entry.isMask = false;
+	entry.label = label;
+	entry.user = datasetUser;
+	entry.path = QString("%1-%2.png")
+			.arg(dataset.getUsers()[datasetUser].name.c_str())
+			.arg(datasetFrames++).toStdString();
+
+	if(cv::imwrite(dataset.framePath(entry), frame))
+		dataset.addFrame(entry);
+}
+
+/*
+	Starts or stops recording feature vectors (and the frames they came
+	from) during training
+*/
+void MainWindow::toggleFeatureLog()
+{
+	if(featureLog.isOpen())
 	{
-		//FAILURE
-		numSuccesses = 0;
+		featureLog.close();
+		datasetUser = -1;
+		ui->feedbackBrowser->append("Stopped recording features.");
+		return;
 	}
-	
 
-	return img;
+	featureLog.setFileName(FEATURE_LOG.c_str());
+	if(!featureLog.open(QIODevice::Append | QIODevice::Text))
+		return;
+	ui->feedbackBrowser->append(QString("Recording features to %1")
+									.arg(FEATURE_LOG.c_str()));
+
+	// each recording session is a user of the dataset, with the current
+	// calibration and skin range
+	QDir().mkpath(DATASET_DIR.c_str());
+	if(!dataset.open(DATASET_DIR))
+		return;
+
+	DatasetUser u;
+	u.name = QDateTime::currentDateTime()
+					.toString("yyyyMMdd-hhmmss").toStdString();
+	u.left = user.isLeft();
+	user.calibratedAngles(u.angles);
+	u.hsvMin = min;
+	u.hsvMax = max;
+	datasetUser = dataset.addUser(u);
+	datasetFrames = 0;
+}
+
+// Opens the camera (or the recording given), run on a loading thread
+bool MainWindow::openCamera()
+{
+	source = openFrameSource(sourceSpec.empty() ?
+								std::to_string(CAMERA) : sourceSpec);
+	return source != 0;
+}
+
+/*
+	Reads the named HSV ranges saved in file (name#hmin#smin#vmin#hmax#
+	smax#vmax lines), run on a loading thread
+*/
+std::vector<LocationPreset> MainWindow::readLocations(const std::string& file)
+{
+	std::vector<LocationPreset> presets;
+	QFile prefs(file.c_str());
+	if(!prefs.open(QIODevice::ReadOnly | QIODevice::Text))
+		return presets;
+
+	QTextStream stream(&prefs);
+	while(!stream.atEnd())
+	{
+		QString line = stream.readLine();
+		if(line.size() < 10)
+			continue;
+		QStringList strList = line.split("#", QString::SkipEmptyParts);
+		if(strList.size() < 7)
+			continue;
+
+		LocationPreset loc;
+		loc.name = strList.at(0);
+		loc.min = cv::Scalar(strList.at(1).toInt(), strList.at(2).toInt(),
+							strList.at(3).toInt());
+		loc.max = cv::Scalar(strList.at(4).toInt(), strList.at(5).toInt(),
+							strList.at(6).toInt());
+		presets.push_back(loc);
+	}
+	return presets;
+}
+
+/*
+	Prints how long each part of the startup took, once the first frame
+	has been processed and the cascade is in. A benchmark run then quits.
+*/
+void MainWindow::reportStartup()
+{
+	if(firstFrameMs < 0 || cascadeMs < 0)
+		return;
+
+	qDebug() << "startup (ms): camera" << cameraMs << "presets" << presetsMs
+			<< "face cascade" << cascadeMs << "first processed frame"
+			<< firstFrameMs;
+	if(benchmarking)
+	{
+		std::cout << "camera " << cameraMs << " ms\npresets " << presetsMs
+				<< " ms\nface cascade " << cascadeMs
+				<< " ms\nfirst processed frame " << firstFrameMs
+				<< " ms" << std::endl;
+		benchmarking = false;
+		QApplication::quit();
+	}
+}
+
+/*
+	Takes the calibration, location and templates saved under name,
+	returns false (and leaves the user alone) if there is no such profile
+*/
+bool MainWindow::loadProfile(const std::string& name)
+{
+	UserProfile p;
+	if(name.empty() || !profiles.load(name, p))
+		return false;
+
+	// nothing is saved while the profile is half applied
+	profileName.clear();
+	user.setProfile(p, params);
+
+	int location = ui->comboBox->findText(p.location.c_str());
+	if(location >= 0)
+		ui->comboBox->setCurrentIndex(location);
+	min = p.hsvMin;
+	max = p.hsvMax;
+	setSliders();
+
+	profileName = name;
+	profiles.setLast(name);
+	ui->textBrowser->setText(QString("Welcome back, %1.").arg(name.c_str()));
+	return true;
+}
+
+/*
+	Saves the user's calibration, location and templates to their
+	profile, if they have one
+*/
+void MainWindow::saveProfile()
+{
+	if(profileName.empty())
+		return;
+
+	UserProfile p;
+	p.name = profileName;
+	user.getProfile(p);
+	p.location = ui->comboBox->currentText().toStdString();
+	p.hsvMin = min;
+	p.hsvMax = max;
+	if(profiles.save(p))
+		profiles.setLast(profileName);
+	else
+	{
+		qDebug() << "Could not save profile" << profileName.c_str();
+		ui->textBrowser->append(QString("Could not save profile ") +
+								profileName.c_str());
+	}
 }
 
 void MainWindow::loadDefaultHands()
@@ -375,16 +655,54 @@ void MainWindow::setThreshold()
 	Controls the display of the video, on the interval set in
 	toggleCamera above. It also regulates the display of the 
 	histogram, and processing of the video if they are enabled.
+	Every frame is processed, but only the ones the scheduler picks
+	are shown.
 */
 void MainWindow::updateTimer()
 {
 	cv::Mat img, result;
-	cap >> img; //capture a frame
+	if(!source->grab()) //capture a frame
+	{
+		// the end of a recording
+		toggleCamera();
+		return;
+	}
+	// everything is timed by the source, a recording by its own clock
+	frameMs = source->timestamp();
+	user.setFrameTime(frameMs);
+	bool show = scheduler.tick(frameMs);
+
+	// the frame is only decoded if something uses it
+	if(!show && !histEnable && !backProcess && !measureHand && !handDetect &&
+		!training)
+		return;
+
+	// a raw YUV frame in YCrCb mode is thresholded as it is, and searched
+	// for faces on its Y plane, so it is only converted to BGR when it is
+	// shown (the measure tab crops, the histogram and recording want color)
+	rawFrame = yuvSource && !measureHand && !histEnable &&
+			!featureLog.isOpen() &&
+			SkinDetectController::getInstance()->getMode() == SKIN_YCRCB;
+	if(rawFrame && !show)
+	{
+		const cv::Mat& raw = yuvSource->getRaw();
+		img = raw.rowRange(0, raw.rows * 2 / 3);
+	}
+	else
+	{
+		if(!source->retrieve(frameBuffer))
+		{
+			toggleCamera();
+			return;
+		}
+		img = frameBuffer;
+	}
 
 	if(histEnable)
-	{   // update the histogram
-		histogram = cHist.getHistogramImage(img);
-		cv::imshow("Histogram", histogram);
+	{   // update the histogram, the plot is redrawn a few times a second
+		liveHist.update(img);
+		if(liveHist.redraw(frameMs))
+			cv::imshow("Histogram", liveHist.getImage());
 	}
 	if(backProcess)
 		result = processSkin(img);
@@ -395,8 +713,19 @@ void MainWindow::updateTimer()
 	else if(training)
 		result = trainUser(img);
 
+	if(firstFrameMs < 0 && !result.empty())
+	{
+		firstFrameMs = startupClock.elapsed();
+		reportStartup();
+	}
+
+	if(!show)
+		return;
+
 	if (!result.empty())
 		img = result;
+	if(handDetect)
+		drawOverlays(img);
 	displayMat(img, ui->label_Camera);
 }
 
@@ -410,6 +739,9 @@ void MainWindow::updateTimer()
 */
 void MainWindow::on_tabWidget_currentChanged(int index)
 {
+	// the measure tab works on a crop, so the track does not carry over
+	user.resetTracking();
+
 	switch(index)
 	{
 		case START_TAB:
@@ -484,7 +816,7 @@ void MainWindow::setImage()
 */
 void MainWindow::toggleCamera()
 {
-	if(!cap.isOpened())
+	if(!cameraReady)
 		return;
 	if(timer->isActive())
 	{
@@ -493,7 +825,8 @@ void MainWindow::toggleCamera()
 	}
 	else
 	{
-		timer->start(TIMER_DELAY);
+		// a recording is read as fast as it is processed
+		timer->start(source->isLive() ? TIMER_DELAY : 0);
 		ui->pushButton_Camera->setText("Hide Camera");
 	}
 
@@ -527,10 +860,85 @@ void MainWindow::keyPressEvent(QKeyEvent *e)
 			QPixmap img_pix(250,250); 
 			img_pix.fill();
 			ui->label_Example->setPixmap(img_pix);
+
+			// keep the measurement for next time, asking again until the
+			// name can be saved under or the dialog is cancelled
+			bool ok;
+			QString name = profileName.c_str();
+			while(true)
+			{
+				name = QInputDialog::getText(this, tr("Save profile"),
+									tr("Your name:"), QLineEdit::Normal,
+									name, &ok);
+				if(!ok || name.isEmpty())
+					break;
+				if(ProfileStore::validName(name.toStdString()))
+				{
+					profileName = name.toStdString();
+					saveProfile();
+					break;
+				}
+				QMessageBox::warning(this, tr("Save profile"),
+						tr("A profile name cannot contain / or \\."));
+			}
 		}
 
 		toggleCamera();
 	}
+	else if(e->key() == 82 && training) // r
+	{
+		toggleFeatureLog();
+	}
+	else if(e->key() == 69 && training && !curGoalSet.empty()) // e
+	{
+		std::string gesture = curGoalSet.back();
+		if(user.enrollTemplate(gesture))
+		{
+			ui->feedbackBrowser->append(QString("Saved example %1 of %2.")
+					.arg(user.gallery.countFor(Hand::translateType(gesture)))
+					.arg(gesture.c_str()));
+			saveProfile();
+		}
+	}
+	else if(e->key() == 80) // p
+	{
+		// switch to another saved trainee
+		QStringList names;
+		for(const std::string& name : profiles.names())
+			names << name.c_str();
+		if(names.isEmpty())
+			return;
+		bool ok;
+		QString name = QInputDialog::getItem(this, tr("Load profile"),
+								tr("Profile:"), names, 0, false, &ok);
+		if(ok && !name.isEmpty())
+			loadProfile(name.toStdString());
+	}
+	else if(e->key() == 89) // y
+	{
+		// next skin model (raw YUV sources skip the conversions in YCrCb,
+		// the histogram is trained on the current frame)
+		SkinDetectController *skin = SkinDetectController::getInstance();
+		skin->setMode(skin->getMode() == SKIN_HISTOGRAM ? SKIN_HSV :
+						SkinMode(skin->getMode() + 1));
+		ui->textBrowser->append(QString("Skin: ") + skinModeName(skin->getMode()));
+	}
+	else if(e->key() == 79) // o
+	{
+		showOverlays = !showOverlays;
+	}
+	else if(e->key() == 68) // d
+	{
+		// back to none from the windows, close them
+		DebugLevel level = scheduler.cycleLevel();
+		if(level == DEBUG_NONE)
+		{
+			cv::destroyWindow("fingerIMG");
+			ui->textBrowser->clear();
+		}
+		ui->textBrowser->append(QString("Debug: %1")
+									.arg(debugLevelName(level)));
+	}
 	else if(e->key() == 88 && measureHand) // x
 	{
 		user.fist = Hand();
@@ -573,6 +981,7 @@ void MainWindow::showHistogram()
 	if(timer->isActive() && !histEnable)
 	{   //create histogram window for video display
 		cv::namedWindow("Histogram", cv::WINDOW_AUTOSIZE);
+		liveHist.reset();
 		histEnable = true;
 	}
 	else if (!timer->isActive() && !histEnable )
@@ -784,12 +1193,73 @@ void MainWindow::on_pushButton_Detect_clicked()
 }
 
 
+//---------Startup--------------
+
+void MainWindow::cameraOpened()
+{
+	if(cameraMs < 0)
+		cameraMs = startupClock.elapsed();
+	cameraReady = cameraWatcher.result();
+	yuvSource = dynamic_cast<RawYUVSource*>(source);
+	ui->pushButton_Camera->setEnabled(cameraReady);
+	if(!cameraReady)
+	{
+		qDebug() << "Could not open" << (sourceSpec.empty() ?
+								QString::number(CAMERA) : sourceSpec.c_str());
+		if(benchmarking)
+			QApplication::exit(1);
+		return;
+	}
+
+	// run straight into detection
+	if(benchmarking && !timer->isActive())
+	{
+		handDetect = true;
+		toggleCamera();
+	}
+}
+
+void MainWindow::cascadeLoaded()
+{
+	cascadeMs = startupClock.elapsed();
+	if(!cascadeWatcher.result())
+		qDebug() << "Could not load face cascade" << FACEFILE.c_str();
+	reportStartup();
+}
+
+void MainWindow::presetsLoaded()
+{
+	presetsMs = startupClock.elapsed();
+	std::vector<LocationPreset> presets = presetWatcher.result();
+	for(const LocationPreset& loc : presets)
+	{
+		locationNames.push_back(loc.name);
+		locations.push_back({loc.min, loc.max});
+	}
+
+	//default HSV filter is the first location
+	if(!locations.empty())
+	{
+		min = locations[0][0];
+		max = locations[0][1];
+		setSliders();
+	}
+
+	for(const LocationPreset& loc : presets)
+		ui->comboBox->addItem(loc.name);
+
+	// a returning trainee picks up where they left off, no measuring
+	loadProfile(profiles.last());
+}
+
+
 void MainWindow::on_comboBox_currentIndexChanged(int index)
 {
 	// qDebug() << "Location:  " << index;
 	min = locations[index][0];
 	max = locations[index][1];
 	setSliders();
+	saveProfile();
 }
 
 void MainWindow::on_pushButton_Training_clicked()
@@ -810,24 +1280,14 @@ void MainWindow::on_pushButton_Training_clicked()
 				std::shuffle(curGoalSet.begin(), curGoalSet.end(), g);
 			}
 			
-			std::string gesture = curGoalSet.back();
-			curType = Hand::translateType(gesture);
+			// timing restarts on resume, a paused goal is not counted
+			showNextGoal();
 
-			QString str = QString::fromStdString(goalDir + 
-							gesture + imgExtension);
-			// qDebug() << str;
-
-			QPixmap img_pix(str);
-			ui->label_Goal->setPixmap(img_pix.scaled(
-					ui->label_Goal->size(), Qt::KeepAspectRatio));
-
-			str = QString("Please make the gesture signifying the letter %1"
-						" as shown below in the left-hand box")
-						.arg(gesture.c_str());
+			QString str = QString("Please make the gesture signifying the"
+						" letter %1 as shown below in the left-hand box")
+						.arg(curGoalSet.back().c_str());
 			ui->feedbackBrowser->setText(str);
 
-			numSuccesses = 0;
-
 		}
 		else
 		{
@@ -22,6 +22,7 @@
 #define MAINWINDOW_H
 
 // QT Includes
+#include <QApplication>
 #include <QMainWindow>
 #include <QCheckBox>
 #include <QLabel>
@@ -30,6 +31,12 @@
 #include <QKeyEvent>
 #include <QDebug>
 #include <QInputDialog>
+#include <QMessageBox>
+#include <QDir>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 
 //OpenCV
 #include <opencv2/core/core.hpp>
@@ -42,26 +49,46 @@
 #include <random>
 #include <algorithm>
 #include <iterator>
+#include <map>
 
 // Local Includes
 #include "../detectors/skindetectcontroller.h"	//singleton processes skin regions
 #include "../detectors/handdetectcontroller.h"	//singleton that finds hands
 #include "../include/colorhistogram.h"		//for displaying a 3 color histogram
+#include "../include/livehistogram.h"		//the same, cheaply, for video
 #include "../include/user.h"
+#include "../include/gesturedataset.h"	//labelled frames for gestureeval
+#include "../include/gesturevoter.h"	//decides when a goal gesture is held
+#include "../include/framedisplay.h"	//frames to label sized images
+#include "../include/displayscheduler.h"	//which frames are shown
+#include "../include/framesource.h"	//camera, recordings and raw dumps
 
 
 namespace Ui {
 class MainWindow;
 }
 
+// A named HSV range from LOC_PREFS
+struct LocationPreset
+{
+	QString name;
+	cv::Scalar min, max;
+};
+
 class MainWindow : public QMainWindow
 {
 	Q_OBJECT
 	
 public:
-	explicit MainWindow(QWidget *parent = 0);
+	// source is a frame source spec (see openFrameSource), the camera
+	// CAMERA if empty
+	explicit MainWindow(QWidget *parent = 0, const std::string &source = "");
 	~MainWindow();
 
+	// Starts detecting as soon as the camera is open, and quits after
+	// reporting the startup times (--startup-benchmark)
+	void benchmarkStartup();
+
 
 
 	
@@ -70,6 +97,7 @@ protected:
 	void displayMat(const cv::Mat img, QLabel *label);
 	cv::Mat processSkin( const cv::Mat img );
 	cv::Mat processHand( const cv::Mat color, const cv::Mat binary );
+	void drawOverlays( cv::Mat img );
 	cv::Mat detectHand( const cv::Mat img );
 	cv::Mat measureHands( cv::Mat img );
 	cv::Mat trainUser( cv::Mat img );
@@ -77,6 +105,18 @@ protected:
 
 	bool copyFile(const QString& src, const QString& dst);
 
+	void logFeatures(const std::string& label);
+	void recordFrame(const cv::Mat& frame, const std::string& label);
+	void recordRecognition(const std::string& gesture, double ms);
+	void showNextGoal();
+	void toggleFeatureLog();
+
+	bool openCamera();
+	static std::vector<LocationPreset> readLocations(const std::string& file);
+	void reportStartup();
+
+	bool loadProfile(const std::string& name);
+	void saveProfile();
 	void loadDefaultHands();
 
 	// UI Functions
@@ -88,8 +128,27 @@ protected:
 private:
 	Ui::MainWindow *ui;
 
-	// camera vars
-	cv::VideoCapture cap;
+	// camera vars, source belongs to the opening thread until
+	// cameraReady. Frames are read into frameBuffer, frameMs is the
+	// source's time of the current one.
+	std::string sourceSpec;
+	FrameSource *source;
+	cv::Mat frameBuffer;
+	double frameMs;
+	// source, if it is a raw YUV dump (its frames skip the conversions),
+	// and whether the current frame is used as it is, without BGR
+	RawYUVSource *yuvSource;
+	bool rawFrame;
+	bool cameraReady;
+
+	// startup work done on other threads, and when each part finished
+	// (ms since the window was created, -1 until then)
+	QFutureWatcher<bool> cameraWatcher;
+	QFutureWatcher<bool> cascadeWatcher;
+	QFutureWatcher<std::vector<LocationPreset> > presetWatcher;
+	QElapsedTimer startupClock;
+	qint64 cameraMs, cascadeMs, presetsMs, firstFrameMs;
+	bool benchmarking;
 
 	// timer vars
 	QTimer *timer;
@@ -100,21 +159,54 @@ private:
 	std::vector<std::vector<cv::Scalar> > locations;
 	std::vector<QString> locationNames;
 
-	// histogram vars
+	// histogram vars, the live one follows the video
 	cv::Mat histogram;
 	ColorHistogram cHist;
+	LiveHistogram liveHist;
+
+	// display buffers of each label frames are shown in
+	std::map<QLabel*, FrameDisplay> displays;
+
+	// whether the hand and faces are drawn over the frames shown, and
+	// the buffer the hand's highlight is drawn in
+	bool showOverlays;
+	cv::Mat overlayBuffer;
+
+	// picks the frames shown (DISPLAY_HZ), and the debug level ('d')
+	DisplayScheduler scheduler;
 
 	// The users data
 	User user;
 
+	// saved trainees, and the one in use (empty until named)
+	ProfileStore profiles;
+	std::string profileName;
+
+	// detector tuning, from DETECTOR_PREFS
+	DetectorParams params;
+
 	// Training vars
 	std::vector<std::string> goalGestures = {"A", "V", "I", "T", "L", "Y","W"};
 	std::vector<std::string> curGoalSet;
 	std::string imgExtension = ".jpg";
 	std::string goalDir = ":/img/goal/";
-	int numSuccesses;
 	HandType curType;
 
+	// votes over the last frames for the gesture being held, and when the
+	// current goal was shown
+	GestureVoter voter;
+	double goalStartMs;
+
+	// time to recognize each goal gesture this session, in ms
+	std::map<std::string, std::vector<double> > recognitionTimes;
+
+	// labelled feature vectors written while training, for gesturetrain
+	QFile featureLog;
+
+	// labelled frames recorded alongside the features, for gestureeval
+	GestureDataset dataset;
+	int datasetUser, datasetFrames;
+
 
 	// CONSTANTS
 	const static char 
@@ -126,12 +218,20 @@ private:
 		TRAIN_TAB = 4,
 	// Camera ( 0 = sys default / 1 = iGlasses )
 		CAMERA = 0,
-	// Timer delay in ms
-		TIMER_DELAY = 25;
+	// Timer delay in ms for a camera, recordings run as fast as they can
+		TIMER_DELAY = 25,
+	// Most frames shown per second, the rest are only processed
+		DISPLAY_HZ = 20;
 
 	cv::Scalar COLOR_CAP_RECT = cv::Scalar(0,0,125);
 
 	std::string LOC_PREFS = "../../../../GestureTrainer/prefs/location.prefs.dat";
+	std::string GESTURE_MODEL = "../../../../GestureTrainer/prefs/gesture.model";
+	std::string FEATURE_LOG = "../../../../GestureTrainer/prefs/features.dat";
+	std::string DATASET_DIR = "../../../../GestureTrainer/prefs/dataset";
+	std::string DETECTOR_PREFS = "../../../../GestureTrainer/prefs/detector.prefs.dat";
+	std::string RECOGNITION_LOG = "../../../../GestureTrainer/prefs/recognition.dat";
+	std::string PROFILE_DIR = "../../../../GestureTrainer/prefs/profiles";
 
 	
 private slots:
@@ -144,6 +244,11 @@ private slots:
 	void on_comboBox_currentIndexChanged(int index);
 	//void trainUser();
 
+	// Startup Slots
+	void cameraOpened();
+	void cascadeLoaded();
+	void presetsLoaded();
+
 	//Background Slots
 	void processColorDetection();
 	void showHistogram();
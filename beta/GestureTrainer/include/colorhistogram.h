@@ -34,6 +34,8 @@
 #include <iostream>
 #include <stdio.h>
 
+#include "pointkernels.h"
+
 class ColorHistogram {
 
   private:
@@ -176,26 +178,40 @@ class ColorHistogram {
 
 	cv::Mat colorReduce(const cv::Mat &image, int div=64) 
 	{
+	  cv::Mat result;
+	  colorReduce(image, result, div);
+	  return result;
+	}
+
+	/*
+		Same as above into result, which can be image itself (in place) or
+		a buffer kept between frames, it is only reallocated when the
+		size or type changes. div must be a power of 2 (up to 128) and
+		image 8 bit; the rows are run through the SIMD reduceBytes kernel
+		(see pointkernels.h).
+	*/
+	void colorReduce(const cv::Mat &image, cv::Mat &result, int div=64)
+	{
+	  CV_Assert(image.depth() == CV_8U && div > 0 && div <= 128 &&
+				(div & (div - 1)) == 0);
 
-	  int n= static_cast<int>(log(static_cast<double>(div))/log(2.0));
+	  int n= 0;
+	  while((1 << n) < div)
+		n++;
 	  // mask used to round the pixel value
 	  uchar mask= 0xFF<<n; // e.g. for div=16, mask= 0xF0
 
-	  cv::Mat_<cv::Vec3b>::const_iterator it= image.begin<cv::Vec3b>();
-	  cv::Mat_<cv::Vec3b>::const_iterator itend= image.end<cv::Vec3b>();
-
-	  // Set output image (always 1-channel)
-	  cv::Mat result(image.rows,image.cols,image.type());
-	  cv::Mat_<cv::Vec3b>::iterator itr= result.begin<cv::Vec3b>();
+	  result.create(image.rows, image.cols, image.type());
 
-	  for ( ; it!= itend; ++it, ++itr) {
-        
-        (*itr)[0]= ((*it)[0]&mask) + div/2;
-        (*itr)[1]= ((*it)[1]&mask) + div/2;
-        (*itr)[2]= ((*it)[2]&mask) + div/2;
+	  int rows= image.rows, bytes= image.cols * image.elemSize();
+	  if(image.isContinuous() && result.isContinuous())
+	  {
+		bytes*= rows;
+		rows= 1;
 	  }
-
-	  return result;
+	  for (int r= 0; r < rows; r++)
+		reduceBytes(image.ptr<uchar>(r), result.ptr<uchar>(r), bytes,
+					mask, div/2);
 	}
 
 	// Returns an image of a histogram of the image in BGR
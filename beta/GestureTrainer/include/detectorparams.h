@@ -0,0 +1,101 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	The tuning knobs of the skin and hand detectors in one place, so they
+	can be set together (and searched over by tools/gesturesweep) instead
+	of being constants spread through SkinDetector, HandDetector and Hand.
+	The defaults are the values those classes always used.
+
+	Stored as a prefs file with one name#value line per knob, missing
+	names keep their defaults.
+
+*/
+
+
+#ifndef DETECTORPARAMS_H
+#define DETECTORPARAMS_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+
+struct DetectorParams
+{
+	// SkinDetector: side of the square erode/dilate element
+	int morphSize = 5;
+
+	// SkinDetector: step the HSV colors are rounded to before
+	// thresholding (a power of 2), 0 to leave them
+	int colorReduce = 0;
+
+	// HandDetector: smallest contour area taken as a hand
+	int minHandSize = 2000;
+
+	// Hand: shallowest convexity defect (in pixels) used to fit the palm
+	// of an open hand
+	double minDefectSize = 10.0;
+
+	// Hand: a finger's tip must be this many palm radii from the center,
+	// and its area over the palm radius below maxFingerRatio
+	double minTipRatio = 1.5;
+	double maxFingerRatio = 50.0;
+
+	// Hand: palm radius scale tried when fewer than 4 fingers are found
+	float retryRadius = 1.1f;
+
+
+	bool load(const std::string& filename)
+	{
+		std::ifstream in(filename.c_str());
+		if(!in)
+			return false;
+
+		std::string line;
+		while(std::getline(in, line))
+		{
+			std::stringstream stream(line);
+			std::string name, value;
+			if(!std::getline(stream, name, '#') || !std::getline(stream, value))
+				continue;
+
+			if(name == "morphSize")
+				morphSize = std::atoi(value.c_str());
+			else if(name == "colorReduce")
+			{
+				// anything but 0 or a power of 2 up to 128 is ignored
+				int div = std::atoi(value.c_str());
+				if(div >= 0 && div <= 128 && (div & (div - 1)) == 0)
+					colorReduce = div;
+			}
+			else if(name == "minHandSize")
+				minHandSize = std::atoi(value.c_str());
+			else if(name == "minDefectSize")
+				minDefectSize = std::atof(value.c_str());
+			else if(name == "minTipRatio")
+				minTipRatio = std::atof(value.c_str());
+			else if(name == "maxFingerRatio")
+				maxFingerRatio = std::atof(value.c_str());
+			else if(name == "retryRadius")
+				retryRadius = std::atof(value.c_str());
+		}
+		return true;
+	}
+
+	bool save(const std::string& filename) const
+	{
+		std::ofstream out(filename.c_str());
+		out << "morphSize#" << morphSize
+			<< "\ncolorReduce#" << colorReduce
+			<< "\nminHandSize#" << minHandSize
+			<< "\nminDefectSize#" << minDefectSize
+			<< "\nminTipRatio#" << minTipRatio
+			<< "\nmaxFingerRatio#" << maxFingerRatio
+			<< "\nretryRadius#" << retryRadius << "\n";
+		return (bool)out;
+	}
+};
+
+#endif
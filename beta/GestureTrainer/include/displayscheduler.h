@@ -0,0 +1,110 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Decides which camera frames are shown. Every frame is processed, but
+	the labels, stats panel and debug windows are only refreshed at a
+	capped rate, so drawing and formatting do not take time from the
+	recognition when the camera is faster than the eye needs.
+
+	The debug level picks what is shown besides the video: nothing, the
+	user and hand stats, or those and the OpenCV debug windows.
+
+*/
+
+
+#ifndef DISPLAYSCHEDULER_H
+#define DISPLAYSCHEDULER_H
+
+
+enum DebugLevel {
+	DEBUG_NONE,
+	DEBUG_STATS,
+	DEBUG_WINDOWS
+};
+
+inline const char* debugLevelName(DebugLevel level)
+{
+	switch(level)
+	{
+		case DEBUG_STATS:
+			return "stats";
+		case DEBUG_WINDOWS:
+			return "stats and windows";
+		default:
+			return "none";
+	}
+}
+
+
+class DisplayScheduler
+{
+
+private:
+	double intervalMs, lastMs;
+	// whether the frame of the last tick is shown
+	bool shown;
+	DebugLevel level;
+
+public:
+	DisplayScheduler(double hz = 20, DebugLevel debug = DEBUG_NONE)
+		: lastMs(-1e9), shown(false), level(debug)
+	{
+		setRate(hz);
+	}
+
+	// Refresh rate of the display, in frames per second
+	void setRate(double hz)
+	{
+		intervalMs = hz > 0 ? 1000 / hz : 0;
+	}
+
+	/*
+		Called once per processed frame, at time ms (milliseconds,
+		increasing). Returns true if this frame should be shown.
+	*/
+	bool tick(double ms)
+	{
+		shown = ms - lastMs >= intervalMs;
+		if(shown)
+		{
+			// keep to the rate on average, without bursts after a stall
+			lastMs += intervalMs;
+			if(lastMs < ms - intervalMs)
+				lastMs = ms - intervalMs;
+		}
+		return shown;
+	}
+
+	// Whether the current frame is shown
+	bool showing() const
+	{
+		return shown;
+	}
+
+	// Whether the current frame updates the stats panel
+	bool stats() const
+	{
+		return shown && level >= DEBUG_STATS;
+	}
+
+	// Whether the current frame updates the debug windows
+	bool windows() const
+	{
+		return shown && level >= DEBUG_WINDOWS;
+	}
+
+	DebugLevel getLevel() const
+	{
+		return level;
+	}
+
+	// Moves to the next debug level, back to none after the last
+	DebugLevel cycleLevel()
+	{
+		level = level == DEBUG_WINDOWS ? DEBUG_NONE : DebugLevel(level + 1);
+		return level;
+	}
+};
+
+#endif
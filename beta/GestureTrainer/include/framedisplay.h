@@ -0,0 +1,67 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Turns frames (BGR or single channel) into a QImage for a label of a
+	given size. The frame is first scaled down to the label, and only the
+	small image is converted to RGB, both into buffers that are kept
+	between frames. The QImage shares the buffer, so the only copy left is
+	the one Qt makes into the pixmap.
+
+*/
+
+
+#ifndef FRAMEDISPLAY_H
+#define FRAMEDISPLAY_H
+
+#include <QImage>
+#include <QSize>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+
+
+class FrameDisplay
+{
+
+private:
+	// frame scaled to the label, and the same in RGB
+	cv::Mat scaled, rgb;
+	QImage image;
+
+public:
+	/*
+		Scales img to fit in size (keeping its aspect ratio) and converts
+		it to RGB. The image is valid until the next call.
+	*/
+	const QImage& convert(const cv::Mat& img, const QSize& size)
+	{
+		if(img.empty() || size.width() <= 0 || size.height() <= 0)
+		{
+			image = QImage();
+			return image;
+		}
+
+		double scale = std::min((double)size.width() / img.cols,
+								(double)size.height() / img.rows);
+		cv::Size fit(std::max(1, cvRound(img.cols * scale)),
+					std::max(1, cvRound(img.rows * scale)));
+
+		// area averaging shrinks without aliasing, most frames shrink
+		const bool rescale = fit != img.size();
+		if(rescale)
+			cv::resize(img, scaled, fit, 0, 0,
+						scale < 1 ? cv::INTER_AREA : cv::INTER_LINEAR);
+
+		const cv::Mat& src = rescale ? scaled : img;
+		cv::cvtColor(src, rgb, src.channels() == 1 ? CV_GRAY2RGB : CV_BGR2RGB);
+
+		image = QImage(rgb.data, rgb.cols, rgb.rows, rgb.step,
+						QImage::Format_RGB888);
+		return image;
+	}
+};
+
+#endif
@@ -0,0 +1,336 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Where frames come from: a camera, a video file, a directory of images
+	or a raw YUV dump (NV12 or I420, as cameras deliver it). The same
+	pipeline can then run live or on recordings, the recorded ones as fast
+	as they can be read.
+
+	As with cv::VideoCapture, grab() moves to the next frame and
+	retrieve() decodes it, so frames that are skipped are never decoded.
+	retrieve() writes into the Mat it is given, which keeps its buffer as
+	long as the size stays the same. Every frame has a timestamp in
+	milliseconds: the steady clock for a camera, the position in the
+	recording otherwise.
+
+	openFrameSource() picks the source from a spec string, see below.
+
+*/
+
+
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <QDir>
+#include <QStringList>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+
+
+class FrameSource
+{
+
+public:
+	virtual ~FrameSource() {}
+
+	virtual bool isOpened() const = 0;
+
+	// Moves to the next frame without decoding it, false at the end
+	virtual bool grab() = 0;
+
+	// Decodes the grabbed frame into frame (BGR)
+	virtual bool retrieve(cv::Mat &frame) = 0;
+
+	// Milliseconds of the grabbed frame
+	virtual double timestamp() const = 0;
+
+	// Whether frames arrive in real time (a camera), recordings are
+	// read as fast as they are processed
+	virtual bool isLive() const
+	{
+		return false;
+	}
+
+	bool read(cv::Mat &frame)
+	{
+		return grab() && retrieve(frame);
+	}
+};
+
+
+class CameraSource : public FrameSource
+{
+
+private:
+	cv::VideoCapture cap;
+	double ms;
+
+public:
+	explicit CameraSource(int index = 0) : ms(0)
+	{
+		cap.open(index);
+	}
+
+	bool isOpened() const
+	{
+		return cap.isOpened();
+	}
+
+	bool isLive() const
+	{
+		return true;
+	}
+
+	bool grab()
+	{
+		if(!cap.grab())
+			return false;
+		ms = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		return true;
+	}
+
+	bool retrieve(cv::Mat &frame)
+	{
+		return cap.retrieve(frame);
+	}
+
+	double timestamp() const
+	{
+		return ms;
+	}
+};
+
+
+class VideoSource : public FrameSource
+{
+
+private:
+	cv::VideoCapture cap;
+	double ms;
+
+public:
+	explicit VideoSource(const std::string &file) : ms(0)
+	{
+		cap.open(file);
+	}
+
+	bool isOpened() const
+	{
+		return cap.isOpened();
+	}
+
+	bool grab()
+	{
+		if(!cap.grab())
+			return false;
+		ms = cap.get(CV_CAP_PROP_POS_MSEC);
+		return true;
+	}
+
+	bool retrieve(cv::Mat &frame)
+	{
+		return cap.retrieve(frame);
+	}
+
+	double timestamp() const
+	{
+		return ms;
+	}
+};
+
+
+// The images of a directory in name order, fps apart
+class ImageDirSource : public FrameSource
+{
+
+private:
+	std::string dir;
+	QStringList files;
+	int next;
+	double frameMs;
+
+	// the encoded file, kept between frames
+	std::vector<uchar> encoded;
+
+public:
+	ImageDirSource(const std::string &directory, double fps = 30)
+		: dir(directory), next(0), frameMs(1000 / fps)
+	{
+		QStringList images;
+		images << "*.jpg" << "*.jpeg" << "*.png" << "*.bmp";
+		files = QDir(dir.c_str()).entryList(images, QDir::Files, QDir::Name);
+	}
+
+	bool isOpened() const
+	{
+		return !files.isEmpty();
+	}
+
+	bool grab()
+	{
+		if(next >= files.size())
+			return false;
+		next++;
+		return true;
+	}
+
+	bool retrieve(cv::Mat &frame)
+	{
+		if(next <= 0)
+			return false;
+
+		std::string path = dir + "/" + files[next - 1].toStdString();
+		std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+		if(!in)
+			return false;
+		encoded.resize(in.tellg());
+		in.seekg(0);
+		if(encoded.empty() || !in.read((char*)&encoded[0], encoded.size()))
+			return false;
+
+		// decodes into frame's buffer when it fits
+		cv::imdecode(encoded, 1, &frame);
+		return !frame.empty();
+	}
+
+	double timestamp() const
+	{
+		return (next - 1) * frameMs;
+	}
+};
+
+
+/*
+	Raw YUV 4:2:0 frames one after another, as dumped from a camera:
+	a full size Y plane followed by either interleaved UV (NV12) or a U
+	then a V plane (I420), fps apart.
+*/
+class RawYUVSource : public FrameSource
+{
+
+public:
+	enum Layout {
+		NV12,
+		I420
+	};
+
+private:
+	FILE *file;
+	int width, height;
+	Layout layout;
+	double frameMs;
+	int frame;
+
+	// the grabbed frame, height * 3/2 rows of width bytes
+	cv::Mat raw;
+
+	RawYUVSource(const RawYUVSource&) = delete;
+	RawYUVSource& operator=(const RawYUVSource&) = delete;
+
+public:
+	RawYUVSource(const std::string &path, int w, int h, Layout l = NV12,
+				double fps = 30)
+		: width(w), height(h), layout(l), frameMs(1000 / fps), frame(-1)
+	{
+		file = w > 0 && h > 0 && w % 2 == 0 && h % 2 == 0 ?
+					std::fopen(path.c_str(), "rb") : 0;
+		raw.create(h * 3 / 2, w, CV_8UC1);
+	}
+
+	~RawYUVSource()
+	{
+		if(file)
+			std::fclose(file);
+	}
+
+	bool isOpened() const
+	{
+		return file != 0;
+	}
+
+	// Reads the frame (cheap, no conversion)
+	bool grab()
+	{
+		if(!file || std::fread(raw.data, 1, raw.total(), file) != raw.total())
+			return false;
+		frame++;
+		return true;
+	}
+
+	bool retrieve(cv::Mat &bgr)
+	{
+		if(frame < 0)
+			return false;
+		cv::cvtColor(raw, bgr,
+					layout == NV12 ? CV_YUV2BGR_NV12 : CV_YUV2BGR_I420);
+		return true;
+	}
+
+	// The grabbed frame as it is in the file, valid until the next grab
+	const cv::Mat& getRaw() const
+	{
+		return raw;
+	}
+
+	Layout getLayout() const
+	{
+		return layout;
+	}
+
+	double timestamp() const
+	{
+		return frame * frameMs;
+	}
+};
+
+
+/*
+	Opens a source from spec, 0 if it cannot be opened:
+		"" or a number			that camera (default 0)
+		file.nv12@640x480		raw NV12 frames of that size
+		file.yuv@640x480		raw I420 frames of that size
+		a directory				its images
+		anything else			a video file
+	The caller owns the source.
+*/
+inline FrameSource* openFrameSource(const std::string &spec)
+{
+	FrameSource *source = 0;
+
+	if(spec.empty() || spec.find_first_not_of("0123456789") == std::string::npos)
+		source = new CameraSource(std::atoi(spec.c_str()));
+	else if(spec.find('@') != std::string::npos)
+	{
+		std::string path = spec.substr(0, spec.rfind('@'));
+		int w = 0, h = 0;
+		std::sscanf(spec.c_str() + spec.rfind('@') + 1, "%dx%d", &w, &h);
+
+		bool nv12 = path.size() > 5 && path.substr(path.size() - 5) == ".nv12";
+		source = new RawYUVSource(path, w, h,
+						nv12 ? RawYUVSource::NV12 : RawYUVSource::I420);
+	}
+	else if(QDir(spec.c_str()).exists())
+		source = new ImageDirSource(spec);
+	else
+		source = new VideoSource(spec);
+
+	if(!source->isOpened())
+	{
+		delete source;
+		return 0;
+	}
+	return source;
+}
+
+#endif
@@ -0,0 +1,322 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	A packed corpus of frames that have already been through the skin and
+	hand detectors, so classifier experiments do not have to decode and
+	threshold every image again. Built from a dataset by tools/gesturecorpus
+	and read by gesturetrain and gestureeval.
+
+	The file is memory mapped and read in place. Layout (native byte order,
+	every section 8 byte aligned):
+
+		header		magic, record size, HandFeatures size, record count,
+					offset of the record table
+		data		per frame: its dataset path, the hand mask inside the
+					bounding box run length encoded, and the contour
+		records		CorpusRecord[count], pointing into the data
+
+	Masks are encoded row by row as alternating run lengths of background
+	and hand pixels, starting with background. Runs longer than a uint16
+	are split with a zero length run of the other value.
+
+*/
+
+
+#ifndef GESTURECORPUS_H
+#define GESTURECORPUS_H
+
+#include <QFile>
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdint.h>
+
+#include "../include/handfeatures.h"
+#include "../include/gesturemodel.h"
+
+
+struct CorpusRecord
+{
+	// HandType shown and the user's calibration when it was recorded
+	int32_t label;
+	int32_t left;
+	float calib[5];
+
+	// as User::curFeatures, type NONE if no hand was found
+	HandFeatures features;
+
+	// hand bounding box the mask covers, in frame coordinates
+	int32_t maskX, maskY, maskWidth, maskHeight;
+
+	uint64_t nameOffset, runsOffset, pointsOffset;
+	uint32_t nameLength, numRuns, numPoints;
+};
+
+
+class GestureCorpus
+{
+
+private:
+	QFile file;
+	const uchar* data;
+	qint64 length;
+	const CorpusRecord* records;
+	int count;
+
+
+	struct Header
+	{
+		uint32_t magic, recordSize, featuresSize, count;
+		uint64_t recordsOffset;
+	};
+
+	static const uint32_t MAGIC = 0x31435447; // "GTC1"
+
+	friend class CorpusWriter;
+
+	bool inside(uint64_t offset, uint64_t bytes) const
+	{
+		return offset <= (uint64_t)length && bytes <= length - offset;
+	}
+
+public:
+	GestureCorpus() : data(0), length(0), records(0), count(0) {}
+
+	~GestureCorpus()
+	{
+		close();
+	}
+
+	// True if filename starts like a corpus, to tell it from other inputs
+	static bool isCorpus(const std::string& filename)
+	{
+		std::ifstream in(filename.c_str(), std::ios::binary);
+		uint32_t magic = 0;
+		in.read((char*)&magic, sizeof(magic));
+		return in && magic == MAGIC;
+	}
+
+	/*
+		Maps the corpus in filename. Fails on files written with a
+		different layout, or whose records point outside the file.
+	*/
+	bool open(const std::string& filename)
+	{
+		close();
+		file.setFileName(filename.c_str());
+		if(!file.open(QIODevice::ReadOnly))
+			return false;
+
+		length = file.size();
+		data = file.map(0, length);
+		if(!data || length < (qint64)sizeof(Header))
+		{
+			close();
+			return false;
+		}
+
+		const Header* h = (const Header*)data;
+		if(h->magic != MAGIC || h->recordSize != sizeof(CorpusRecord) ||
+			h->featuresSize != sizeof(HandFeatures) || h->recordsOffset % 8 ||
+			!inside(h->recordsOffset, (uint64_t)h->count * sizeof(CorpusRecord)))
+		{
+			close();
+			return false;
+		}
+
+		records = (const CorpusRecord*)(data + h->recordsOffset);
+		for(uint32_t i = 0; i < h->count; i++)
+		{
+			const CorpusRecord& r = records[i];
+			// labels and types index the tools' tables, both are a HandType
+			if(r.label < 0 || r.label > GESTURE_MAX_LABEL ||
+				r.features.type < 0 || r.features.type > GESTURE_MAX_LABEL ||
+				!inside(r.nameOffset, r.nameLength) ||
+				!inside(r.runsOffset, (uint64_t)r.numRuns * sizeof(uint16_t)) ||
+				!inside(r.pointsOffset, (uint64_t)r.numPoints * sizeof(cv::Point)))
+			{
+				close();
+				return false;
+			}
+		}
+		count = h->count;
+		return true;
+	}
+
+	void close()
+	{
+		if(data)
+			file.unmap((uchar*)data);
+		file.close();
+		data = 0;
+		records = 0;
+		length = count = 0;
+	}
+
+	int size() const
+	{
+		return count;
+	}
+
+	const CorpusRecord& record(int i) const
+	{
+		return records[i];
+	}
+
+	std::string name(const CorpusRecord& r) const
+	{
+		return std::string((const char*)data + r.nameOffset, r.nameLength);
+	}
+
+	// The contour, in place in the file (numPoints long)
+	const cv::Point* contour(const CorpusRecord& r) const
+	{
+		return (const cv::Point*)(data + r.pointsOffset);
+	}
+
+	// Decodes the hand mask (0 or 255, bounding box sized) into out,
+	// which is reused if it is already the right size
+	void mask(const CorpusRecord& r, cv::Mat& out) const
+	{
+		out.create(r.maskHeight, r.maskWidth, CV_8U);
+		const uint16_t* runs = (const uint16_t*)(data + r.runsOffset);
+
+		uchar* p = out.ptr<uchar>(0);
+		uchar* end = p + out.total();
+		uchar value = 0;
+		for(uint32_t i = 0; i < r.numRuns && p < end; i++)
+		{
+			int n = std::min((int)runs[i], (int)(end - p));
+			std::fill(p, p + n, value);
+			p += n;
+			value = ~value;
+		}
+		std::fill(p, end, 0);
+	}
+
+	// Run length encodes a binary mask, see above
+	static void encodeMask(const cv::Mat& mask, std::vector<uint16_t>& runs)
+	{
+		runs.clear();
+		uchar value = 0;
+		uint32_t run = 0;
+		for(int y = 0; y < mask.rows; y++)
+		{
+			const uchar* row = mask.ptr<uchar>(y);
+			for(int x = 0; x < mask.cols; x++)
+			{
+				uchar v = row[x] > 127 ? 255 : 0;
+				if(v != value)
+				{
+					runs.push_back(run);
+					value = v;
+					run = 0;
+				}
+				if(++run == UINT16_MAX)
+				{
+					runs.push_back(run);
+					runs.push_back(0);
+					run = 0;
+				}
+			}
+		}
+		runs.push_back(run);
+	}
+};
+
+
+/*
+	Writes a corpus one record at a time, the data is streamed out and
+	only the record table is kept until close()
+*/
+class CorpusWriter
+{
+
+private:
+	std::ofstream out;
+	std::vector<CorpusRecord> records;
+	uint64_t pos;
+
+
+	uint64_t write(const void* bytes, uint64_t size)
+	{
+		uint64_t at = pos;
+		out.write((const char*)bytes, size);
+		pos += size;
+
+		static const char pad[8] = {};
+		if(pos % 8)
+		{
+			out.write(pad, 8 - pos % 8);
+			pos += 8 - pos % 8;
+		}
+		return at;
+	}
+
+public:
+	~CorpusWriter()
+	{
+		if(out.is_open())
+			close();
+	}
+
+	bool open(const std::string& filename)
+	{
+		records.clear();
+		out.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+
+		// filled in by close()
+		GestureCorpus::Header h = {};
+		pos = 0;
+		write(&h, sizeof(h));
+		return (bool)out;
+	}
+
+	/*
+		Adds a frame. r holds the label, calibration, features and mask
+		box, the offsets are filled in here.
+	*/
+	void add(CorpusRecord r, const std::string& name,
+			const std::vector<uint16_t>& runs,
+			const std::vector<cv::Point>& contour)
+	{
+		r.nameLength = name.size();
+		r.nameOffset = write(name.data(), name.size());
+		r.numRuns = runs.size();
+		r.runsOffset = write(runs.empty() ? 0 : &runs[0],
+								runs.size() * sizeof(uint16_t));
+		r.numPoints = contour.size();
+		r.pointsOffset = write(contour.empty() ? 0 : &contour[0],
+								contour.size() * sizeof(cv::Point));
+		records.push_back(r);
+	}
+
+	int size() const
+	{
+		return records.size();
+	}
+
+	// Writes the record table and header, returns false on a write error
+	bool close()
+	{
+		GestureCorpus::Header h;
+		h.magic = GestureCorpus::MAGIC;
+		h.recordSize = sizeof(CorpusRecord);
+		h.featuresSize = sizeof(HandFeatures);
+		h.count = records.size();
+		h.recordsOffset = write(records.empty() ? 0 : &records[0],
+								records.size() * sizeof(CorpusRecord));
+
+		out.seekp(0);
+		out.write((const char*)&h, sizeof(h));
+		bool ok = (bool)out;
+		out.close();
+		return ok;
+	}
+};
+
+#endif
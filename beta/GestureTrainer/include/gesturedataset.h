@@ -0,0 +1,195 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	A labelled gesture dataset on disk, for measuring recognition. A
+	dataset is a directory holding the frames (color images or already
+	thresholded masks) and an index, dataset.dat, in the same # separated
+	style as the location prefs. Two kinds of lines:
+
+	user#name#left#thumb#index#middle#ring#pinky#minH#minS#minV#maxH#maxS#maxV
+		a user's calibration (1 for a left hand, finger angles in radians)
+		and the HSV skin range their frames were taken with
+
+	frame#kind#path#label#user
+		kind is img or mask, path is relative to the directory, label is
+		the gesture shown (as in Hand::getType) and user names a user line
+
+*/
+
+
+#ifndef GESTUREDATASET_H
+#define GESTUREDATASET_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+
+struct DatasetUser
+{
+	std::string name;
+	bool left;
+	float angles[5];
+	cv::Scalar hsvMin, hsvMax;
+};
+
+struct DatasetFrame
+{
+	std::string path;
+	bool isMask;
+	std::string label;
+	int user;
+};
+
+
+class GestureDataset
+{
+
+private:
+	std::string dir;
+	std::vector<DatasetUser> users;
+	std::vector<DatasetFrame> frames;
+
+
+	static std::vector<std::string> split(const std::string& line)
+	{
+		std::vector<std::string> fields;
+		std::stringstream stream(line);
+		std::string field;
+		while(std::getline(stream, field, '#'))
+			fields.push_back(field);
+		return fields;
+	}
+
+public:
+	static std::string indexFile(const std::string& dir)
+	{
+		return dir + "/dataset.dat";
+	}
+
+	const std::string& getDir() const
+	{
+		return dir;
+	}
+
+	const std::vector<DatasetUser>& getUsers() const
+	{
+		return users;
+	}
+
+	const std::vector<DatasetFrame>& getFrames() const
+	{
+		return frames;
+	}
+
+	// Full path of a frame's image
+	std::string framePath(const DatasetFrame& frame) const
+	{
+		return dir + "/" + frame.path;
+	}
+
+	// Reads the index of the dataset in directory d. Malformed lines are
+	// skipped, as are frames of unknown users.
+	bool load(const std::string& d)
+	{
+		dir = d;
+		users.clear();
+		frames.clear();
+
+		std::ifstream in(indexFile(dir).c_str());
+		if(!in)
+			return false;
+
+		std::string line;
+		while(std::getline(in, line))
+		{
+			std::vector<std::string> f = split(line);
+			if(f.size() == 14 && f[0] == "user")
+			{
+				DatasetUser u;
+				u.name = f[1];
+				u.left = std::atoi(f[2].c_str());
+				for(int i = 0; i < 5; i++)
+					u.angles[i] = std::atof(f[3 + i].c_str());
+				for(int i = 0; i < 3; i++)
+				{
+					u.hsvMin[i] = std::atoi(f[8 + i].c_str());
+					u.hsvMax[i] = std::atoi(f[11 + i].c_str());
+				}
+				users.push_back(u);
+			}
+			else if(f.size() == 5 && f[0] == "frame")
+			{
+				DatasetFrame frame;
+				frame.isMask = f[1] == "mask";
+				frame.path = f[2];
+				frame.label = f[3];
+				frame.user = findUser(f[4]);
+				if(frame.user >= 0)
+					frames.push_back(frame);
+			}
+		}
+		return true;
+	}
+
+	// Latest user line with this name, so frames use the calibration
+	// that was current when they were recorded
+	int findUser(const std::string& name) const
+	{
+		for(int i = users.size() - 1; i >= 0; i--)
+			if(users[i].name == name)
+				return i;
+		return -1;
+	}
+
+	/*
+		Starts (or continues) recording into directory d, the index is
+		appended to as users and frames are added.
+	*/
+	bool open(const std::string& d)
+	{
+		if(!load(d))
+		{
+			dir = d;
+			std::ofstream create(indexFile(dir).c_str());
+			if(!create)
+				return false;
+		}
+		return true;
+	}
+
+	// Adds a user, a user of the same name is replaced for new frames
+	int addUser(const DatasetUser& u)
+	{
+		std::ofstream out(indexFile(dir).c_str(), std::ios::app);
+		out << "user#" << u.name << "#" << u.left;
+		for(int i = 0; i < 5; i++)
+			out << "#" << u.angles[i];
+		for(int i = 0; i < 3; i++)
+			out << "#" << u.hsvMin[i];
+		for(int i = 0; i < 3; i++)
+			out << "#" << u.hsvMax[i];
+		out << "\n";
+
+		users.push_back(u);
+		return users.size() - 1;
+	}
+
+	// Adds a frame whose image is already saved at path (relative to the
+	// dataset directory)
+	void addFrame(const DatasetFrame& frame)
+	{
+		std::ofstream out(indexFile(dir).c_str(), std::ios::app);
+		out << "frame#" << (frame.isMask ? "mask" : "img") << "#"
+			<< frame.path << "#" << frame.label << "#"
+			<< users[frame.user].name << "\n";
+		frames.push_back(frame);
+	}
+};
+
+#endif
@@ -0,0 +1,213 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	A trained gesture classifier. A Hand's features, together with the
+	user's calibrated finger angles, are turned into a fixed length
+	feature vector which is run down a small decision tree. The tree is
+	trained offline (tools/gesturetrain) and stored as a flat array of
+	nodes in a compact binary file that is loaded at startup.
+
+	Labels are HandType values, kept as ints so this header does not
+	depend on hand.h.
+
+*/
+
+
+#ifndef GESTUREMODEL_H
+#define GESTUREMODEL_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <stdint.h>
+
+#include "../include/handfeatures.h"
+
+
+// Largest label a model may hold, NONE (checked against HandType in user.h)
+static const int GESTURE_MAX_LABEL = 11;
+
+// Layout of the feature vector
+enum GestureFeature {
+	GF_NUM_FINGERS = 0,
+	// distance from each calibrated finger (thumb .. pinky) to the
+	// closest finger found, PI if there are none
+	GF_CALIB_DIST = 1,
+	// finger angles, largest first, -1 for missing fingers
+	GF_ANGLES = GF_CALIB_DIST + HandFeatures::MAX_FINGERS,
+	// palm area over hand area
+	GF_PALM_RATIO = GF_ANGLES + HandFeatures::MAX_FINGERS,
+	// deepest defects over palm radius, deepest first
+	GF_DEFECTS,
+	// log scaled Hu moments
+	GF_HU = GF_DEFECTS + 4,
+	GF_C2B_SLOPE = GF_HU + HandFeatures::NUM_HU,
+	GF_C2E_SLOPE,
+	GF_LEFT,
+	// FIST or PALM, as found by Hand::findClass
+	GF_BASE_TYPE,
+
+	GESTURE_FEATURES
+};
+
+
+/*
+	Fills out[GESTURE_FEATURES] from a hand's features. calib holds the
+	user's calibrated thumb, index, middle, ring and pinky angles.
+*/
+inline void gestureFeatures(const HandFeatures& f, const float calib[5],
+							bool left, float out[GESTURE_FEATURES])
+{
+	const float PI_F = 3.1415926f;
+	const int nf = std::min(f.numFingers, (int)HandFeatures::MAX_FINGERS);
+
+	out[GF_NUM_FINGERS] = f.numFingers;
+
+	for(int c = 0; c < 5; c++)
+	{
+		float best = PI_F;
+		for(int i = 0; i < nf; i++)
+			best = std::min(best, std::abs(f.fingerAngles[i] - calib[c]));
+		out[GF_CALIB_DIST + c] = best;
+	}
+
+	float angles[HandFeatures::MAX_FINGERS];
+	std::copy(f.fingerAngles, f.fingerAngles + nf, angles);
+	std::sort(angles, angles + nf, std::greater<float>());
+	for(int i = 0; i < HandFeatures::MAX_FINGERS; i++)
+		out[GF_ANGLES + i] = i < nf ? angles[i] : -1;
+
+	out[GF_PALM_RATIO] = f.m00 > 0 ? f.palmArea / f.m00 : 0;
+
+	float depths[HandFeatures::MAX_DEFECTS];
+	const int nd = std::min(f.numDefects, (int)HandFeatures::MAX_DEFECTS);
+	std::copy(f.defectDepths, f.defectDepths + nd, depths);
+	std::sort(depths, depths + nd, std::greater<float>());
+	for(int i = 0; i < 4; i++)
+		out[GF_DEFECTS + i] = (i < nd && f.palmRadius > 0) ?
+								depths[i] / f.palmRadius : 0;
+
+	for(int i = 0; i < HandFeatures::NUM_HU; i++)
+	{
+		double h = f.hu[i];
+		out[GF_HU + i] = h == 0 ? 0 : -std::copysign(1.0, h) *
+										std::log10(std::abs(h));
+	}
+
+	// slopes are unbounded (vertical lines), clamp them
+	out[GF_C2B_SLOPE] = f.hasSlopes ?
+			std::max(-100.0f, std::min(100.0f, f.c2bSlope)) : 0;
+	out[GF_C2E_SLOPE] = f.hasSlopes ?
+			std::max(-100.0f, std::min(100.0f, f.c2eSlope)) : 0;
+	out[GF_LEFT] = left;
+	out[GF_BASE_TYPE] = f.type;
+}
+
+
+class GestureModel
+{
+
+public:
+	// One node of the flattened tree. Leaves have feature -1 and a label,
+	// inner nodes send x[feature] <= threshold left and the rest right.
+	struct Node
+	{
+		int16_t feature;
+		int16_t label;
+		float threshold;
+		int32_t left, right;
+	};
+
+private:
+	std::vector<Node> nodes;
+
+	static const uint32_t MAGIC = 0x314d5447, // "GTM1"
+						MAX_NODES = 1 << 16;
+
+public:
+	GestureModel() {}
+
+	GestureModel(const std::vector<Node>& n) : nodes(n) {}
+
+	bool isLoaded() const
+	{
+		return !nodes.empty();
+	}
+
+	const std::vector<Node>& getNodes() const
+	{
+		return nodes;
+	}
+
+	// Label (a HandType) for a feature vector, -1 if no model is loaded
+	int classify(const float x[GESTURE_FEATURES]) const
+	{
+		if(nodes.empty())
+			return -1;
+
+		const Node* node = &nodes[0];
+		while(node->feature >= 0)
+			node = &nodes[x[node->feature] <= node->threshold ?
+							node->left : node->right];
+		return node->label;
+	}
+
+	/*
+		File layout: magic, feature count, node count (uint32 each)
+		followed by the nodes as stored in memory.
+	*/
+	bool load(const std::string& filename)
+	{
+		nodes.clear();
+		std::ifstream in(filename.c_str(), std::ios::binary);
+		if(!in)
+			return false;
+
+		uint32_t header[3];
+		in.read((char*)header, sizeof(header));
+		if(!in || header[0] != MAGIC || header[1] != GESTURE_FEATURES ||
+			header[2] == 0 || header[2] > MAX_NODES)
+			return false;
+
+		std::vector<Node> tmp(header[2]);
+		in.read((char*)&tmp[0], tmp.size() * sizeof(Node));
+		if(!in)
+			return false;
+
+		// children always come after their parent, anything else is a
+		// corrupt file (and could loop forever), and leaves hold a HandType
+		for(int i = 0; i < (int)tmp.size(); i++)
+		{
+			const Node& n = tmp[i];
+			if(n.feature >= GESTURE_FEATURES)
+				return false;
+			if(n.feature < 0 && (n.label < 0 || n.label > GESTURE_MAX_LABEL))
+				return false;
+			if(n.feature >= 0 && (n.left <= i || n.right <= i ||
+				n.left >= (int)tmp.size() || n.right >= (int)tmp.size()))
+				return false;
+		}
+
+		nodes.swap(tmp);
+		return true;
+	}
+
+	bool save(const std::string& filename) const
+	{
+		std::ofstream out(filename.c_str(), std::ios::binary);
+		if(!out || nodes.empty())
+			return false;
+
+		uint32_t header[3] = { MAGIC, GESTURE_FEATURES,
+								(uint32_t)nodes.size() };
+		out.write((const char*)header, sizeof(header));
+		out.write((const char*)&nodes[0], nodes.size() * sizeof(Node));
+		return (bool)out;
+	}
+};
+
+#endif
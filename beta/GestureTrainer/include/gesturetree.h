@@ -0,0 +1,29 @@
+/*
+
+	Generated by tools/gesturegen, do not edit.
+
+	The trained gesture model compiled in as branches, used in place
+	of a model file when GESTURE_COMPILED_MODEL is defined.
+
+	(Placeholder: no model has been compiled in yet, and kiosk builds
+	stop until one is. Regenerate with gesturegen from a trained model.)
+
+*/
+
+
+#ifndef GESTURETREE_H
+#define GESTURETREE_H
+
+#include "../include/gesturemodel.h"
+
+
+static constexpr int GESTURE_TREE_NODES = 0,
+					GESTURE_TREE_DEPTH = 0;
+
+// Label (a HandType) for a feature vector, -1 if the tree is empty
+inline int compiledGestureClass(const float[GESTURE_FEATURES])
+{
+	return -1;
+}
+
+#endif
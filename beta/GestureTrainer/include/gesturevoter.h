@@ -0,0 +1,142 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Decides which gesture is being held from the per frame classes over a
+	sliding window of time. Each frame's class counts for as long as it
+	was on screen (until the next frame), so the result does not depend
+	on the frame rate, and a few noisy frames only lower the confidence
+	instead of starting over.
+
+	A gesture is recognized once it fills ENTER of a window that is mostly
+	covered by frames, and stays recognized until it falls below EXIT.
+
+	Labels are HandType values, kept as ints so this header does not
+	depend on hand.h.
+
+*/
+
+
+#ifndef GESTUREVOTER_H
+#define GESTUREVOTER_H
+
+#include <algorithm>
+
+
+class GestureVoter
+{
+
+private:
+	struct Vote
+	{
+		double ms;
+		int label;
+	};
+
+	static const int CAPACITY = 256,
+					// labels 0 .. MAX_LABELS - 1 are counted
+					MAX_LABELS = 16;
+
+	Vote votes[CAPACITY];
+	int first, count;
+
+	// recognized label, -1 for none
+	int state;
+
+	// time each label was shown in the window, and the total covered
+	double weights[MAX_LABELS];
+	double covered;
+	int leader;
+
+	double windowMs;
+
+
+	static constexpr float ENTER = 0.7f,
+						EXIT = 0.4f,
+						// part of the window frames must cover to decide
+						MIN_COVERED = 0.75f;
+	// longest a single frame counts for, in case the camera stalls
+	static constexpr double MAX_HOLD_MS = 200;
+
+
+	const Vote& at(int i) const
+	{
+		return votes[(first + i) % CAPACITY];
+	}
+
+	void tally()
+	{
+		std::fill(weights, weights + MAX_LABELS, 0.0);
+		covered = 0;
+		for(int i = 0; i + 1 < count; i++)
+		{
+			const Vote &v = at(i), &next = at(i + 1);
+			double held = next.ms - v.ms;
+			if(held > MAX_HOLD_MS)
+				held = MAX_HOLD_MS;
+			if(v.label >= 0 && v.label < MAX_LABELS)
+				weights[v.label] += held;
+			covered += held;
+		}
+
+		leader = std::max_element(weights, weights + MAX_LABELS) - weights;
+	}
+
+public:
+	GestureVoter(double window = 800) : windowMs(window)
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		first = count = 0;
+		state = leader = -1;
+		covered = 0;
+		std::fill(weights, weights + MAX_LABELS, 0.0);
+	}
+
+	/*
+		Adds the class seen at time ms (milliseconds, increasing). Returns
+		the recognized label, -1 if there is none.
+	*/
+	int vote(int label, double ms)
+	{
+		// drop what has left the window, and the oldest if full
+		while(count > 0 && (at(0).ms < ms - windowMs || count == CAPACITY))
+		{
+			first = (first + 1) % CAPACITY;
+			count--;
+		}
+		votes[(first + count++) % CAPACITY] = { ms, label };
+
+		tally();
+		if(state >= 0 && confidence(state) < EXIT)
+			state = -1;
+		if(state < 0 && covered >= MIN_COVERED * windowMs &&
+			confidence(leader) >= ENTER)
+			state = leader;
+		return state;
+	}
+
+	// Part of the covered window that showed label
+	float confidence(int label) const
+	{
+		if(covered <= 0 || label < 0 || label >= MAX_LABELS)
+			return 0;
+		return weights[label] / covered;
+	}
+
+	int recognized() const
+	{
+		return state;
+	}
+
+	// The label shown most in the window, -1 before any frames
+	int getLeader() const
+	{
+		return covered > 0 ? leader : -1;
+	}
+};
+
+#endif
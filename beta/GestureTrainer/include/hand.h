@@ -16,14 +16,19 @@
 #include <QString>
 
 #include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
 
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <algorithm>
 #include <cmath>
+#include <climits>
 
 #include "../include/user.h"
+#include "../include/handfeatures.h"
+#include "../include/pointkernels.h"
+#include "../include/detectorparams.h"
 
 	
 // COLORS
@@ -50,7 +55,7 @@ struct Finger {
 	cv::RotatedRect ellipse;
 	std::vector<cv::Point> contour;
 	cv::Point tip;
-	double angle;
+	double angle = 0;
 };
 
 
@@ -77,6 +82,11 @@ private:
 	std::vector<std::vector< cv::Point > > contour;
 	std::vector<std::vector< cv::Point > > hull;
 	cv::vector<cv::Vec4i> defects;
+
+	// hull indices and unfiltered defects, computed once per contour and
+	// filtered again whenever MIN_DEFECT_SIZE changes
+	std::vector<int> hullIdxs;
+	std::vector<cv::Vec4i> rawDefects;
 	cv::RotatedRect rotRect;
 	cv::Point2f rotPoints[4];
 	cv::Rect boxRect;
@@ -96,12 +106,16 @@ private:
 	std::vector<Finger> fingers;
 
 
-	static const unsigned int MAX_DEFECTS = 8,
+	static const unsigned int MAX_DEFECTS = HandFeatures::MAX_DEFECTS,
 							MAX_FINGER_SIZE = 3000,
 							MIN_FINGER_SIZE = 700;
+	// pixels around the bounding rect the highlight can spill into
+	static const int HIGHLIGHT_PAD = 4;
+	// tuning knobs, and the defect size in use (dropped to 0 to refit
+	// the palm of a fist)
+	DetectorParams params;
 	double MIN_DEFECT_SIZE = 10.0,
-			MIN_FINGER_RATIO = 10.0,
-			MAX_FINGER_RATIO = 50.0;
+			MIN_FINGER_RATIO = 10.0;
 
 
 
@@ -120,13 +134,15 @@ public:
 	}
 
 	//Constructor
-	Hand(std::vector<cv::Point> c)
+	Hand(std::vector<cv::Point> c,
+			const DetectorParams& p = DetectorParams()) : params(p)
 	{
 		if(c.size() <= 0)
 			Hand();
 		else
 		{
 			type = UNK;
+			MIN_DEFECT_SIZE = params.minDefectSize;
 
 			contour.push_back(c);
 
@@ -141,6 +157,10 @@ public:
 		contour = h.contour;
 		hull = h.hull;
 		defects = h.defects;
+		hullIdxs = h.hullIdxs;
+		rawDefects = h.rawDefects;
+		params = h.params;
+		MIN_DEFECT_SIZE = h.MIN_DEFECT_SIZE;
 		rotRect = h.rotRect;
 		rotRect.points(rotPoints);
 		boxRect = h.boxRect;
@@ -166,6 +186,10 @@ public:
 			contour = rhs.contour;
 			hull = rhs.hull;
 			defects = rhs.defects;
+			hullIdxs = rhs.hullIdxs;
+			rawDefects = rhs.rawDefects;
+			params = rhs.params;
+			MIN_DEFECT_SIZE = rhs.MIN_DEFECT_SIZE;
 			rotRect = rhs.rotRect;
 			rotRect.points(rotPoints);
 			boxRect = rhs.boxRect;
@@ -208,6 +232,11 @@ public:
 		return boxRect;
 	}
 
+	const std::vector<cv::Point>& getContour() const
+	{
+		return contour[0];
+	}
+
 	double getB() const
 	{
 		return bRatio;
@@ -219,6 +248,11 @@ public:
 	}
 
 	QString getType() const
+	{
+		return typeName(type);
+	}
+
+	static QString typeName(HandType type)
 	{
 		switch(type)
 		{
@@ -282,6 +316,54 @@ public:
 		return type == NONE;
 	}
 
+	// Summarise the hand into a fixed size record for classification,
+	// logging and IPC. Only reads what calcTraits/findFingers computed.
+	HandFeatures getFeatures() const
+	{
+		HandFeatures f = HandFeatures();
+		f.type = type;
+
+		if(type == NONE || contour[0].empty())
+			return f;
+
+		f.palmX = palmCenter.x;
+		f.palmY = palmCenter.y;
+		f.palmRadius = palmRadius;
+		f.palmArea = palmArea;
+		f.boxX = boxRect.x;
+		f.boxY = boxRect.y;
+		f.boxWidth = boxRect.width;
+		f.boxHeight = boxRect.height;
+
+		f.numFingers = std::min<int>(fingers.size(), HandFeatures::MAX_FINGERS);
+		for(int i = 0; i < f.numFingers; i++)
+		{
+			f.fingerAngles[i] = fingers[i].angle;
+			f.tipX[i] = fingers[i].tip.x + boxRect.x;
+			f.tipY[i] = fingers[i].tip.y + boxRect.y;
+		}
+
+		f.numDefects = std::min<int>(defects.size(), HandFeatures::MAX_DEFECTS);
+		for(int i = 0; i < f.numDefects; i++)
+			f.defectDepths[i] = defects[i][3]/256.0;
+
+		f.m00 = mom.m00;
+		f.m10 = mom.m10;
+		f.m01 = mom.m01;
+		cv::HuMoments(mom, f.hu);
+
+		const std::vector<cv::Point>& c = contour[0];
+		f.hasSlopes = c.size()/2 > 5;
+		if(f.hasSlopes)
+		{
+			const cv::Point &start = c[0], &b = c[5], &e = c[c.size()-5];
+			f.c2bSlope = (double)(start.y - b.y) / (start.x - b.x);
+			f.c2eSlope = (double)(start.y - e.y) / (start.x - e.x);
+		}
+
+		return f;
+	}
+
 
 //	END Modifiers/Accessors
 //##############################################################################
@@ -305,81 +387,51 @@ public:
 		mom = cv::moments(cv::Mat(contour[0]));
 
 		// convex hull and defects
-		std::vector<std::vector<int> > hullIdxs;
-		hullIdxs.push_back(std::vector<int>());
-		cv::convexHull(cv::Mat(contour[0]), hullIdxs[0]);
+		hullIdxs.clear();
+		cv::convexHull(cv::Mat(contour[0]), hullIdxs);
 
 		// gather the hull points into a vector for drawing
 		hull = std::vector<std::vector<cv::Point> >(1);
-		for(int i : hullIdxs[0])
+		for(int i : hullIdxs)
 			hull[0].push_back(contour[0][i]);
 
-		// std::cout << hull[0].size() << std::endl;
-
 		// defects
+		rawDefects.clear();
+		cv::convexityDefects(contour[0], hullIdxs, rawDefects);
+
+		filterDefects();
+	}
+
+	/*
+		Keeps the cached defects deeper than MIN_DEFECT_SIZE and fits the
+		palm circle to their depth points. Cheap enough to re-run when the
+		threshold changes, as the hull and defects are not recomputed.
+	*/
+	void filterDefects()
+	{
 		defects.clear();
-		std::vector<cv::Vec4i> tmpDefects;
-		cv::convexityDefects(contour[0], hullIdxs[0], tmpDefects);
 		std::vector<cv::Point> palmPoints;
 		// Defaults
 		palmCenter = cv::Point(0,0);
 		palmRadius = 0;
 
-
-		if(tmpDefects.size() <= 0)
+		if(rawDefects.size() <= 0)
 			return;
 
-		// if(MIN_DEFECT_SIZE == 0.0) // use average circle for palm
-		if(false)
+		// use minimum enclosing circle
+		for (cv::Vec4i defect : rawDefects)
 		{
-			// /* Average depth points to get hand center */
-			// int x =0, y=0;
-			// for (cv::Vec4i defect : tmpDefects)
-			// {
-			// 	if(defect[3]/256.0 < MIN_DEFECT_SIZE)
-			// 		continue;
-
-			// 	x += contour[0][defect[2]].x;
-			// 	y += contour[0][defect[2]].y;
-
-			// 	defects.push_back(defect);
-			// }
-
-			// if(defects.size() <= 0)
-			// 	return;
-
-			// palmCenter.x = x/defects.size();
-			// palmCenter.y = y/defects.size();
-
-			// /* Compute hand radius as mean of distances of
-			//    defects' depth point to hand center */
-			// int dist = 0;
-			// for(cv::Vec4i defect : defects)
-			// {
-			// 	cv::Point2f tmpPoint = contour[0][defect[2]];
-			// 	dist += pointDist(palmCenter, tmpPoint);
-			// }
-
-			// palmRadius = ((double)dist) / defects.size();
+			if(defect[3]/256.0 < MIN_DEFECT_SIZE)
+				continue;
 
+			defects.push_back(defect);
+			palmPoints.push_back(contour[0][defect[2]]);
 		}
-		else  // use minimum enclosing circle
-		{	
-			for (cv::Vec4i defect : tmpDefects)
-			{
-				if(defect[3]/256.0 < MIN_DEFECT_SIZE)
-					continue;
-
-				defects.push_back(defect);
-				palmPoints.push_back(contour[0][defect[2]]);
-			}
 
+		if(palmPoints.size() <= 0)
+			return;
 
-			if(palmPoints.size() <= 0)
-				return;
-
-			cv::minEnclosingCircle(palmPoints, palmCenter, palmRadius);
-		}
+		cv::minEnclosingCircle(palmPoints, palmCenter, palmRadius);
 
 		// adjust the palm to be smaller/larger if necessary
 		// palmRadius *= .9;
@@ -389,68 +441,12 @@ public:
 	}
 
 
-	cv::Mat extractFingers(cv::Mat handROI)
-	{
-		if(!palmCenter.x || !palmCenter.y)
-			return cv::Mat::zeros(10,10,CV_8UC1);
-		// qDebug() << boxRect.tl().x << ", " << boxRect.tl().y;
-		cv::Point2f palmCenterROI(palmCenter.x - boxRect.tl().x,
-							palmCenter.y - boxRect.tl().y);
-
-		// fill in palm and below to cut off fingers
-		cv::circle( handROI, palmCenterROI, palmRadius, BLACK, CV_FILLED);
-		// eliminate remnants of wrist
-		cv::rectangle( handROI,
-			cv::Point(palmCenterROI.x - palmRadius, palmCenterROI.y),
-			cv::Point(palmCenterROI.x + palmRadius, handROI.rows),
-			BLACK, CV_FILLED);
-		cv::rectangle( handROI,
-			cv::Point(0, palmCenterROI.y + palmRadius/2),
-			cv::Point(handROI.cols, handROI.rows),
-			BLACK, CV_FILLED);
-
-
-		// Re-find contours (whats left are fingers)
-		cv::Mat cloneROI = handROI.clone();
-		std::vector<std::vector<cv::Point> > tmpContours;
-		cv::findContours(cloneROI, tmpContours, CV_RETR_EXTERNAL,
-						CV_CHAIN_APPROX_TC89_L1);
-
-		fingers.clear();
-		// qDebug() << "fingers: ";
-		// qDebug() << "----";
-		for(unsigned int i = 0; i < tmpContours.size(); i++)
-		{
-			unsigned int area = cv::contourArea(tmpContours[i]);
-			double Aratio = (double)area/palmRadius;
-			// qDebug() << "\t" << (double)area/palmRadius;
-			Finger tmpFing;
-			tmpFing.contour = tmpContours[i];
-			double tipDist = findFingerTip(tmpFing);
-			double Dratio = tipDist/palmRadius;
-
-			// if(area > MIN_FINGER_SIZE && area < MAX_FINGER_SIZE)
-			// if(Aratio > MIN_FINGER_RATIO && Aratio < MAX_FINGER_RATIO)
-			if(Dratio > 1.5 && Aratio < MAX_FINGER_RATIO)
-			{
-				// qDebug() << "success ratios: " << Dratio << ", "<< Aratio;
-				// qDebug()<< (double)area/palmRadius;
-				fingers.push_back(tmpFing);
-			}
-//			else
-				// qDebug() << "fail ratio: " << Dratio << ", "<< Aratio;
-		}
-
-		return handROI;
-	}
-
 	void fingerTraits()
 	{
+		// tips were already found when the fingers were extracted
 		cv::Point2f tmpPoint;
 		for (unsigned int i = 0; i < fingers.size(); i++)
 		{
-			findFingerTip(fingers[i]);
-
 			tmpPoint = fingers[i].tip + boxRect.tl();
 
 			fingers[i].angle = std::abs(angleOfPoints(palmCenter, tmpPoint));
@@ -462,92 +458,154 @@ public:
 		}
 	}
 
-	double findFingerTip(Finger& f)
+	/*
+		Finds the fingers straight from the contour and defects, without
+		drawing the hand. A contour point is dropped if it falls in the
+		palm circle or the wrist and the runs of points left over, split
+		at the defect depth points, are the candidate fingers.
+
+		Both palm radii are tested in the same pass over the contour, the
+		fingers found with radii[j] go in found[j]. Finger contours and
+		tips are relative to boxRect.
+	*/
+	void extractFingers(const float radii[2], std::vector<Finger> found[2])
 	{
-		f.tip = f.contour[0];
-		cv::Point2f tmpPoint;
-		double maxDist = 0;
-		for (unsigned int j = 0; j < f.contour.size(); ++j)
+		found[0].clear();
+		found[1].clear();
+		if(!palmCenter.x || !palmCenter.y)
+			return;
+
+		const std::vector<cv::Point>& c = contour[0];
+		const int n = c.size();
+
+		// squared distance of every point from the palm center
+		PointsSoA pts;
+		pts.assign(c);
+		std::vector<float> dist2(n);
+		sqDistances(pts.x.data(), pts.y.data(), n,
+					palmCenter.x, palmCenter.y, dist2.data());
+
+		// bit j is set when the point is cut away by radii[j]
+		std::vector<unsigned char> cut(n, 0);
+		for(int i = 0; i < n; i++)
+			cut[i] = palmMask(pts.x[i] - palmCenter.x,
+							pts.y[i] - palmCenter.y, dist2[i], radii);
+		for (cv::Vec4i defect : defects)
+			cut[defect[2]] = 3;
+
+		for(int j = 0; j < 2; j++)
 		{
-			tmpPoint = f.contour[j] + boxRect.tl();
-			double curDist = pointDist(palmCenter, tmpPoint);
+			const unsigned char bit = 1 << j;
 
-			if(curDist > maxDist)
+			// start just after a cut so no run wraps around the end
+			int first = n - 1;
+			for(int i = 0; i < n; i++)
 			{
-				maxDist = curDist;
-				f.tip = f.contour[j];
+				if(cut[i] & bit)
+				{
+					first = i;
+					break;
+				}
+			}
+
+			// each run's points are gathered, and its tip is the one
+			// farthest from the palm center
+			Finger tmpFing;
+			PointsSoA run;
+			for(int k = 1; k <= n; k++)
+			{
+				int i = (first + k) % n;
+				if(!(cut[i] & bit))
+				{
+					tmpFing.contour.push_back(c[i] - boxRect.tl());
+					run.x.push_back(pts.x[i]);
+					run.y.push_back(pts.y[i]);
+				}
+
+				if(((cut[i] & bit) || k == n) && !tmpFing.contour.empty())
+				{
+					float tipDist2;
+					int tip = maxSqDistance(run.x.data(), run.y.data(),
+								run.size(), palmCenter.x, palmCenter.y, tipDist2);
+					tmpFing.tip = tmpFing.contour[tip];
+					addFinger(tmpFing, std::sqrt(tipDist2), radii[j], found[j]);
+					tmpFing.contour.clear();
+					run.x.clear();
+					run.y.clear();
+				}
 			}
 		}
-		return maxDist;
 	}
 
-	cv::Mat findFingers()
+	// Keeps a candidate finger (with its tip already found) if it is long
+	// and thin enough relative to the palm radius (see DetectorParams)
+	void addFinger(const Finger& tmpFing, double tipDist, float radius,
+					std::vector<Finger>& found)
 	{
-		if(type == NONE || palmRadius == 0 || 
-			boxRect.height <= 0 || boxRect.height > 640)
-			return cv::Mat::zeros(10,10,CV_8UC1);
-
-		// Create a blank image to draw in
-		cv::Mat binaryImg = 
-				cv::Mat::zeros(boxRect.br().y, boxRect.br().x, CV_8UC1);
+		unsigned int area = cv::contourArea(tmpFing.contour);
+		double Aratio = (double)area/radius;
+		double Dratio = tipDist/radius;
 
-		// draw the contour
-		cv::drawContours(binaryImg, contour, 0, WHITE, CV_FILLED);
+		if(Dratio > params.minTipRatio && Aratio < params.maxFingerRatio)
+			found.push_back(tmpFing);
+	}
 
-		// get the points around the palm
-		std::vector<cv::Point> palmPoints;
-		cv::Point2f newCenter;
-		float newRadius;
-		for (cv::Vec4i defect : defects)
+	// Bit j is set if the point at (dx, dy) from the palm center, dist2
+	// away squared, is covered by the palm circle of radius radii[j] or
+	// the wrist below it
+	unsigned char palmMask(float dx, float dy, float dist2,
+							const float radii[2]) const
+	{
+		unsigned char mask = 0;
+		for(int j = 0; j < 2; j++)
 		{
-			palmPoints.push_back(contour[0][defect[2]]);
+			float r = radii[j];
+			if(dist2 <= r * r || (dy >= 0 && std::abs(dx) <= r) || dy >= r/2)
+				mask |= 1 << j;
 		}
+		return mask;
+	}
 
-		if(palmPoints.empty())
-			return binaryImg;
-
-		cv::minEnclosingCircle(palmPoints, newCenter, newRadius);
-		
-		cv::Mat handROI = binaryImg(boxRect);
-
-		extractFingers(handROI);
-
-		// if fewer than 4 fingers are detected, run again with a larger
-		// radius and check result
-		if(fingers.size() < 4)
-		{
-			// qDebug() << "Give it another shot";
-			// backup
-			std::vector<Finger> oldfing = fingers;
-			cv::vector<cv::Vec4i> olddef = defects;
-
-
-			// adjust vars
-			palmRadius *= 1.1;
-
+	void findFingers()
+	{
+		fingers.clear();
+		if(type == NONE || palmRadius == 0 || 
+			boxRect.height <= 0 || boxRect.height > 640)
+			return;
 
-			// convex hull and defects
-			std::vector<std::vector<int> > hullIdxs;
-			hullIdxs.push_back(std::vector<int>());
-			cv::convexHull( contour[0], hullIdxs[0]);
+		if(defects.empty())
+			return;
 
-			defects.clear();
-			cv::convexityDefects(contour[0], hullIdxs[0], defects);
-			extractFingers(handROI);
-			if(fingers.size() <= oldfing.size() && fingers.size() > 0)
-			{
-				fingers = oldfing;
-			}
+		// try the palm as found and slightly larger in one pass
+		const float radii[2] = { palmRadius, palmRadius * params.retryRadius };
+		std::vector<Finger> found[2];
+		extractFingers(radii, found);
 
-			// restore defects and radius
-			defects = olddef;
-			palmRadius /= 1.1;
-		}
+		// if fewer than 4 fingers are detected, use the larger radius
+		// unless it found fewer (but not zero) fingers
+		fingers.swap(found[0]);
+		if(fingers.size() < 4 &&
+			(found[1].size() > fingers.size() || found[1].empty()))
+			fingers.swap(found[1]);
 
 		// get traits for fingers after finalized
 		fingerTraits();
+	}
 
-		return handROI;
+	// Small image of the hand's bounding box with the fingers filled in,
+	// for debugging the finger extraction
+	cv::Mat drawFingers() const
+	{
+		if(type == NONE || boxRect.area() <= 0)
+			return cv::Mat::zeros(10,10,CV_8UC1);
+
+		cv::Mat fingerImg = cv::Mat::zeros(boxRect.size(), CV_8UC1);
+		for(const Finger& finger : fingers)
+		{
+			std::vector<std::vector<cv::Point> > tmp(1, finger.contour);
+			cv::drawContours(fingerImg, tmp, 0, WHITE, CV_FILLED);
+		}
+		return fingerImg;
 	}
 
 	/*
@@ -590,13 +648,13 @@ public:
 		if(fingers.size() >= 1)
 		{
 			type = PALM;
-			MIN_DEFECT_SIZE = 10.0;
+			MIN_DEFECT_SIZE = params.minDefectSize;
 		}
 		else
 		{
-			// set defect size to include all and recalculate
+			// set defect size to include all and refit the palm
 			MIN_DEFECT_SIZE = 0.0;
-			calcTraits();
+			filterDefects();
 			type = FIST;
 		}
 		// qDebug() << getType();
@@ -647,17 +705,38 @@ public:
 	// Draws all the relevant hand data (bounding and rotated rects, contour)
 	// on a cv::Mat that is provided
 	cv::Mat draw(cv::Mat image)
+	{
+		cv::Mat highlight;
+		return draw(image, highlight);
+	}
+
+	/*
+		Same as above, with the highlight drawn into highlight, which can
+		be kept between frames. Only the hand's bounding rect (padded for
+		the anti-aliasing and blur) is drawn and added to the image.
+	*/
+	cv::Mat draw(cv::Mat image, cv::Mat &highlight)
 	{
 		// No hand, don't draw
 		if(type == NONE)
 			return image;
 
+		cv::Rect roi = boxRect;
+		roi -= cv::Point(HIGHLIGHT_PAD, HIGHLIGHT_PAD);
+		roi += cv::Size(2 * HIGHLIGHT_PAD, 2 * HIGHLIGHT_PAD);
+		roi &= cv::Rect(0, 0, image.cols, image.rows);
+
 		// draw onto separate Mat for highlighter effect when added
-		cv::Mat contourImg(image.size(), image.type(), cv::Scalar(0));
-		cv::drawContours( contourImg, contour, 0, 
-							HALF_GREY, CV_FILLED, CV_AA);
-		cv::GaussianBlur( contourImg, contourImg, cv::Size(3,3), 0);
-		image += contourImg;
+		if(roi.area() > 0)
+		{
+			highlight.create(roi.size(), image.type());
+			highlight.setTo(cv::Scalar(0));
+			cv::drawContours( highlight, contour, 0, HALF_GREY, CV_FILLED,
+								CV_AA, cv::noArray(), INT_MAX, -roi.tl());
+			cv::GaussianBlur( highlight, highlight, cv::Size(3,3), 0);
+			cv::Mat imageROI = image(roi);
+			imageROI += highlight;
+		}
 
 		// Draw convex hull
 		cv::drawContours( image, hull, 0, GREY, 2, CV_AA);
@@ -0,0 +1,56 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	A compact, fixed size summary of a Hand. Holds only the numbers that
+	classification needs (fingers, palm, defects, moments) with inline
+	storage, so it can be copied, buffered and sent between threads
+	without touching any of the contour geometry.
+
+*/
+
+
+#ifndef HANDFEATURES_H
+#define HANDFEATURES_H
+
+#include <type_traits>
+
+
+struct HandFeatures
+{
+	static const int MAX_DEFECTS = 8,
+					MAX_FINGERS = 5,
+					NUM_HU = 7;
+
+	// HandType of the hand when the features were taken
+	int type;
+
+	// Palm circle and bounding box (frame coordinates)
+	float palmX, palmY;
+	float palmRadius;
+	float palmArea;
+	int boxX, boxY, boxWidth, boxHeight;
+
+	// Fingers, in the order they were found on the contour
+	int numFingers;
+	float fingerAngles[MAX_FINGERS];
+	float tipX[MAX_FINGERS], tipY[MAX_FINGERS];
+
+	// Depths (in pixels) of the defects that survived filtering
+	int numDefects;
+	float defectDepths[MAX_DEFECTS];
+
+	// Spatial moments and the Hu invariants derived from them
+	double m00, m10, m01;
+	double hu[NUM_HU];
+
+	// Slopes from the start of the contour to a point just after it (b)
+	// and just before it (e), used to tell an A from a T
+	bool hasSlopes;
+	float c2bSlope, c2eSlope;
+};
+
+static_assert(std::is_pod<HandFeatures>::value,
+				"HandFeatures must stay plain old data");
+
+#endif
@@ -0,0 +1,126 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Histogram of the three channels of a live video, cheap enough to run
+	on every frame. Instead of splitting the frame and running calcHist
+	per channel (see ColorHistogram::getHistogramImage), one pass counts
+	all three channels over every STRIDE'th pixel of every STRIDE'th row.
+	The counts are blended into a running histogram, so the plot is
+	steady, and the plot is only redrawn REFRESH_MS apart.
+
+*/
+
+
+#ifndef LIVEHISTOGRAM_H
+#define LIVEHISTOGRAM_H
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+
+
+class LiveHistogram
+{
+
+public:
+	static const int BINS = 256,
+					// every STRIDE'th pixel and row is counted
+					STRIDE = 4,
+					WIDTH = 512,
+					HEIGHT = 400;
+
+private:
+	// running share of the samples in each bin, per channel
+	float smooth[3][BINS];
+	bool empty;
+
+	cv::Mat plot;
+	double lastDrawMs;
+
+	// weight of the newest frame in the running histogram
+	static constexpr float BLEND = 0.25f;
+	static constexpr double REFRESH_MS = 200;
+
+public:
+	LiveHistogram()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		empty = true;
+		lastDrawMs = -REFRESH_MS;
+	}
+
+	// Counts a BGR (or any 3 channel 8 bit) frame into the histogram
+	void update(const cv::Mat &image)
+	{
+		if(image.empty() || image.type() != CV_8UC3)
+			return;
+
+		int counts[3][BINS] = {};
+		int samples = 0;
+		for(int r = 0; r < image.rows; r += STRIDE)
+		{
+			const uchar *p = image.ptr<uchar>(r);
+			const uchar *end = p + 3 * image.cols;
+			for(; p < end; p += 3 * STRIDE, samples++)
+			{
+				counts[0][p[0]]++;
+				counts[1][p[1]]++;
+				counts[2][p[2]]++;
+			}
+		}
+
+		for(int c = 0; c < 3; c++)
+			for(int i = 0; i < BINS; i++)
+			{
+				float share = (float)counts[c][i] / samples;
+				smooth[c][i] = empty ? share :
+									smooth[c][i] + BLEND * (share - smooth[c][i]);
+			}
+		empty = false;
+	}
+
+	/*
+		Redraws the plot if it is REFRESH_MS older than ms (milliseconds,
+		increasing). Returns true if it was redrawn.
+	*/
+	bool redraw(double ms)
+	{
+		if(empty || ms - lastDrawMs < REFRESH_MS)
+			return false;
+		lastDrawMs = ms;
+
+		plot.create(HEIGHT, WIDTH, CV_8UC3);
+		plot.setTo(cv::Scalar::all(0));
+
+		static const cv::Scalar COLORS[3] = { cv::Scalar(255, 0, 0),
+						cv::Scalar(0, 255, 0), cv::Scalar(0, 0, 255) };
+		cv::Point curve[BINS];
+		for(int c = 0; c < 3; c++)
+		{
+			// each channel scaled to the height, as NORM_MINMAX did
+			float top = *std::max_element(smooth[c], smooth[c] + BINS);
+			float scale = top > 0 ? (HEIGHT - 1) / top : 0;
+			for(int i = 0; i < BINS; i++)
+				curve[i] = cv::Point(i * WIDTH / BINS,
+									HEIGHT - 1 - cvRound(smooth[c][i] * scale));
+
+			const cv::Point *curves[1] = { curve };
+			const int points[1] = { BINS };
+			cv::polylines(plot, curves, points, 1, false, COLORS[c], 2);
+		}
+		return true;
+	}
+
+	// The last plot drawn
+	const cv::Mat& getImage() const
+	{
+		return plot;
+	}
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Cheap test for whether a binary mask has changed in a region since it
+	was stored. The region is shrunk to a small grid, thresholded, and
+	XORed against the stored grid; if only a few cells differ the mask is
+	considered the same. Used to skip re-analysing a hand that is being
+	held still.
+
+*/
+
+
+#ifndef MASKCHANGE_H
+#define MASKCHANGE_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+class MaskChange
+{
+
+private:
+	// thresholded grids of the stored and current mask
+	cv::Mat stored, current, diff;
+	cv::Rect storedRegion;
+	cv::Size storedSize;
+
+	// frames matched since the grid was stored
+	int matches;
+
+
+	static const int GRID_SIZE = 32,
+					// cells allowed to differ, about 1% of the grid
+					MAX_CHANGED = 10,
+					// re-check from scratch at least this often
+					MAX_MATCHES = 30;
+
+
+	void sample(const cv::Mat &mask, const cv::Rect &region, cv::Mat &grid)
+	{
+		cv::resize(mask(region), grid, cv::Size(GRID_SIZE, GRID_SIZE),
+					0, 0, cv::INTER_AREA);
+		cv::threshold(grid, grid, 127, 255, cv::THRESH_BINARY);
+	}
+
+public:
+	MaskChange()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		stored.release();
+		storedRegion = cv::Rect();
+		matches = 0;
+	}
+
+	// Stores the grid of mask in region to compare later frames against
+	void store(const cv::Mat &mask, const cv::Rect &region)
+	{
+		matches = 0;
+		if(region.area() <= 0)
+		{
+			reset();
+			return;
+		}
+
+		sample(mask, region, stored);
+		storedRegion = region;
+		storedSize = mask.size();
+	}
+
+	/*
+		True if mask, in the stored region, is effectively the same as
+		when it was stored. Always false every MAX_MATCHES frames so that
+		slow changes are eventually picked up.
+	*/
+	bool unchanged(const cv::Mat &mask)
+	{
+		if(stored.empty() || mask.size() != storedSize)
+			return false;
+
+		if(++matches > MAX_MATCHES)
+			return false;
+
+		sample(mask, storedRegion, current);
+		cv::bitwise_xor(stored, current, diff);
+
+		return cv::countNonZero(diff) <= MAX_CHANGED;
+	}
+
+	const cv::Rect& getRegion() const
+	{
+		return storedRegion;
+	}
+};
+
+#endif
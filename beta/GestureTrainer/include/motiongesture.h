@@ -0,0 +1,334 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Recognition of gestures that are motions rather than poses: the
+	letters J (drawn with the pinky) and Z (drawn with the index finger)
+	and swipes of the whole hand.
+
+	The palm center and fingertips of recent frames are kept in a fixed
+	size ring buffer. Each frame's step, in palm radii per 1/30 s so it
+	does not depend on the hand's size or the frame rate, is fed to a
+	streaming subsequence DTW (SPRING) matcher per template. Every
+	template keeps one column of DTW cells, so a frame costs the same and
+	memory stays the same however long the session runs. Cells whose cost
+	is already over the template's limit, or whose match has run on too
+	long, are abandoned.
+
+	Every frame moves one step along the template, stays, or skips one
+	(and is then matched against both steps), so a match takes between
+	half and MAX_STRETCH times the template's length. Plain DTW would let
+	a single frame match a whole template.
+
+*/
+
+
+#ifndef MOTIONGESTURE_H
+#define MOTIONGESTURE_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+
+enum MotionType {
+	MOTION_NONE,
+	MOTION_J,
+	MOTION_Z,
+	SWIPE_LEFT,
+	SWIPE_RIGHT
+};
+
+inline const char* motionName(MotionType type)
+{
+	switch(type)
+	{
+		case MOTION_J:
+			return "J";
+		case MOTION_Z:
+			return "Z";
+		case SWIPE_LEFT:
+			return "Swipe left";
+		case SWIPE_RIGHT:
+			return "Swipe right";
+		default:
+			return "None";
+	}
+}
+
+
+struct TrajectorySample
+{
+	// the frame source's timestamp in milliseconds (see User::setFrameTime),
+	// the position in the file for a recording
+	double ms;
+	float palmX, palmY, palmRadius;
+	int numTips;
+	float tipX[5], tipY[5];
+};
+
+
+// Index of the highest (smallest y) fingertip, -1 if there are none
+inline int highestTip(const TrajectorySample& s)
+{
+	int best = -1;
+	for(int i = 0; i < s.numTips; i++)
+		if(best < 0 || s.tipY[i] < s.tipY[best])
+			best = i;
+	return best;
+}
+
+
+// The last CAPACITY samples, oldest first
+class Trajectory
+{
+
+public:
+	static const int CAPACITY = 64;
+
+private:
+	TrajectorySample samples[CAPACITY];
+	int first, count;
+
+public:
+	Trajectory() : first(0), count(0) {}
+
+	void push(const TrajectorySample& s)
+	{
+		if(count < CAPACITY)
+			samples[(first + count++) % CAPACITY] = s;
+		else
+		{
+			samples[first] = s;
+			first = (first + 1) % CAPACITY;
+		}
+	}
+
+	void clear()
+	{
+		first = count = 0;
+	}
+
+	int size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	const TrajectorySample& at(int i) const
+	{
+		return samples[(first + i) % CAPACITY];
+	}
+
+	const TrajectorySample& back() const
+	{
+		return at(count - 1);
+	}
+};
+
+
+/*
+	A motion as a sequence of steps in palm radii per frame (image
+	coordinates, y down), traced by the palm or by the highest fingertip
+*/
+struct MotionTemplate
+{
+	MotionType type;
+	bool followsTip;
+	std::vector<cv::Point2f> steps;
+
+	// mean squared step error allowed over a match
+	float maxCost;
+
+	// appends n steps of (dx, dy)
+	MotionTemplate& stroke(float dx, float dy, int n)
+	{
+		steps.insert(steps.end(), n, cv::Point2f(dx, dy));
+		return *this;
+	}
+};
+
+
+class MotionRecognizer
+{
+
+private:
+	struct Cell
+	{
+		float cost;
+		// frame the match ending here started on
+		int start;
+	};
+
+	// DTW state of one template
+	struct Track
+	{
+		std::vector<Cell> column;
+		float bestCost;
+		int bestStart, bestEnd;
+	};
+
+	std::vector<MotionTemplate> templates;
+	std::vector<Track> tracks;
+	int frame;
+
+
+	// matches may take at most this times the template's length
+	static constexpr float MAX_STRETCH = 2.0f;
+	static constexpr float INF = std::numeric_limits<float>::infinity();
+
+
+	static void clear(Track& track)
+	{
+		for(Cell& c : track.column)
+			c.cost = INF;
+		track.bestCost = INF;
+	}
+
+	/*
+		One SPRING step of track against x. Returns true if a match
+		finished (no cell can improve on it any more), with its cost.
+	*/
+	bool step(const MotionTemplate& tmpl, Track& track, const cv::Point2f& x,
+				float& matchCost)
+	{
+		const int m = tmpl.steps.size();
+		const float limit = tmpl.maxCost * m;
+		const int maxLength = MAX_STRETCH * m;
+
+		// a match can start at any frame, D(t - 1, -1) = D(t - 1, -2) = 0
+		Cell before = { 0, frame }, diag = { 0, frame };
+		for(int i = 0; i < m; i++)
+		{
+			Cell up = track.column[i];
+
+			// skipping a step still pays for it
+			if(i > 0 && before.cost < INF)
+			{
+				cv::Point2f skipped = x - tmpl.steps[i - 1];
+				before.cost += skipped.dot(skipped);
+			}
+
+			Cell best = up;
+			if(diag.cost < best.cost)
+				best = diag;
+			if(before.cost < best.cost)
+				best = before;
+
+			cv::Point2f d = x - tmpl.steps[i];
+			Cell cell = { best.cost + d.dot(d), best.start };
+
+			// abandon paths that can no longer match
+			if(cell.cost > limit || frame - cell.start >= maxLength)
+				cell.cost = INF;
+
+			before = diag;
+			diag = up;
+			track.column[i] = cell;
+		}
+
+		const Cell& end = track.column[m - 1];
+		if(end.cost < track.bestCost)
+		{
+			track.bestCost = end.cost;
+			track.bestStart = end.start;
+			track.bestEnd = frame;
+		}
+
+		if(track.bestCost == INF)
+			return false;
+
+		// report once no path that overlaps the best can beat it
+		for(const Cell& c : track.column)
+			if(c.cost < track.bestCost && c.start <= track.bestEnd)
+				return false;
+
+		matchCost = track.bestCost / m;
+		for(Cell& c : track.column)
+			if(c.start <= track.bestEnd)
+				c.cost = INF;
+		track.bestCost = INF;
+		return true;
+	}
+
+public:
+	MotionRecognizer() : frame(0)
+	{
+		MotionTemplate swipeLeft = { SWIPE_LEFT, false };
+		swipeLeft.stroke(-0.6f, 0, 8).maxCost = 0.08f;
+
+		MotionTemplate swipeRight = { SWIPE_RIGHT, false };
+		swipeRight.stroke(0.6f, 0, 8).maxCost = 0.08f;
+
+		// across, back down to the left, across again
+		MotionTemplate z = { MOTION_Z, true };
+		z.stroke(0.5f, 0, 4).stroke(-0.35f, 0.35f, 5).stroke(0.5f, 0, 4)
+			.maxCost = 0.1f;
+
+		// down, then hook to the left and up
+		MotionTemplate j = { MOTION_J, true };
+		j.stroke(0, 0.5f, 5).stroke(-0.25f, 0.4f, 1).stroke(-0.45f, 0.15f, 1)
+			.stroke(-0.45f, -0.15f, 1).stroke(-0.3f, -0.35f, 1).maxCost = 0.1f;
+
+		templates.push_back(swipeLeft);
+		templates.push_back(swipeRight);
+		templates.push_back(z);
+		templates.push_back(j);
+
+		tracks.resize(templates.size());
+		for(unsigned int i = 0; i < templates.size(); i++)
+			tracks[i].column.resize(templates[i].steps.size());
+		reset();
+	}
+
+	// Forgets all partial matches, e.g. when the hand is lost
+	void reset()
+	{
+		for(Track& t : tracks)
+			clear(t);
+	}
+
+	/*
+		Feeds one frame's step of the palm and of the highest fingertip,
+		in palm radii per 1/30 s. A null step (no hand, or no fingertip)
+		breaks the motions that follow it. Returns the motion that just
+		finished, MOTION_NONE if none did.
+	*/
+	MotionType update(const cv::Point2f* palmStep, const cv::Point2f* tipStep)
+	{
+		MotionType found = MOTION_NONE;
+		float foundCost = INF;
+
+		for(unsigned int i = 0; i < templates.size(); i++)
+		{
+			const cv::Point2f* x = templates[i].followsTip ? tipStep : palmStep;
+			if(!x)
+			{
+				clear(tracks[i]);
+				continue;
+			}
+
+			float cost;
+			if(step(templates[i], tracks[i], *x, cost) && cost < foundCost)
+			{
+				found = templates[i].type;
+				foundCost = cost;
+			}
+		}
+
+		// motions do not overlap, start over after one
+		if(found != MOTION_NONE)
+			reset();
+
+		frame++;
+		return found;
+	}
+};
+
+#endif
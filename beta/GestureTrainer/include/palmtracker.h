@@ -0,0 +1,165 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Tracks the palm center and radius from frame to frame with a constant
+	velocity Kalman filter. Smooths the measurements coming out of Hand,
+	keeps predicting through a few frames without a hand, and gives the
+	region where the hand should be in the next frame so the detector
+	only has to search there.
+
+*/
+
+
+#ifndef PALMTRACKER_H
+#define PALMTRACKER_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include <cmath>
+
+
+class PalmTracker
+{
+
+private:
+	// state is (x, y, r, vx, vy, vr), measurement is (x, y, r)
+	cv::KalmanFilter kf;
+	cv::Mat measurement;
+
+	bool tracking;
+	int misses;
+
+	// last measured bounding box and palm center of the hand
+	cv::Rect lastBox;
+	cv::Point2f lastCenter;
+
+
+	static const int MAX_MISSES = 5;
+	// frame fraction of the box added on each side of the predicted ROI
+	static constexpr float ROI_PAD = 0.25f;
+
+
+public:
+	PalmTracker() :
+		kf(6, 3, 0, CV_32F),
+		measurement(3, 1, CV_32F)
+	{
+		// constant velocity, one step per frame
+		kf.transitionMatrix = *(cv::Mat_<float>(6, 6) <<
+			1, 0, 0, 1, 0, 0,
+			0, 1, 0, 0, 1, 0,
+			0, 0, 1, 0, 0, 1,
+			0, 0, 0, 1, 0, 0,
+			0, 0, 0, 0, 1, 0,
+			0, 0, 0, 0, 0, 1);
+
+		cv::setIdentity(kf.measurementMatrix);
+		cv::setIdentity(kf.processNoiseCov, cv::Scalar::all(1));
+		cv::setIdentity(kf.measurementNoiseCov, cv::Scalar::all(10));
+
+		reset();
+	}
+
+	// Copies only start a fresh track, the filter matrices are not shared
+	PalmTracker(const PalmTracker&) : PalmTracker() {}
+
+	PalmTracker& operator=(const PalmTracker& rhs)
+	{
+		if(this != &rhs)
+			reset();
+		return *this;
+	}
+
+	void reset()
+	{
+		tracking = false;
+		misses = 0;
+		lastBox = cv::Rect();
+	}
+
+	bool isTracking() const
+	{
+		return tracking;
+	}
+
+	/*
+		Feeds in the palm measured this frame and the hand's bounding box.
+		center and radius are replaced with the filtered values.
+	*/
+	void update(cv::Point2f& center, float& radius, const cv::Rect& box)
+	{
+		measurement.at<float>(0) = center.x;
+		measurement.at<float>(1) = center.y;
+		measurement.at<float>(2) = radius;
+
+		if(!tracking)
+		{
+			// start at the measurement, not moving
+			kf.statePost = cv::Mat::zeros(6, 1, CV_32F);
+			measurement.copyTo(kf.statePost.rowRange(0, 3));
+			cv::setIdentity(kf.errorCovPost, cv::Scalar::all(10));
+			tracking = true;
+		}
+		else
+		{
+			kf.predict();
+			kf.correct(measurement);
+		}
+
+		misses = 0;
+		lastBox = box;
+		lastCenter = center;
+
+		center.x = kf.statePost.at<float>(0);
+		center.y = kf.statePost.at<float>(1);
+		radius = kf.statePost.at<float>(2);
+	}
+
+	/*
+		No hand this frame, coast on the prediction. After MAX_MISSES
+		frames in a row the track is dropped.
+	*/
+	void miss()
+	{
+		if(!tracking)
+			return;
+
+		if(++misses > MAX_MISSES)
+		{
+			reset();
+			return;
+		}
+
+		kf.predict();
+		kf.statePre.copyTo(kf.statePost);
+		kf.errorCovPre.copyTo(kf.errorCovPost);
+	}
+
+	/*
+		Region the hand should be in next frame: the last box moved by the
+		predicted palm motion and padded by the speed and the number of
+		frames missed. Empty when not tracking, meaning search everywhere.
+		Not clipped to the frame.
+	*/
+	cv::Rect predictROI() const
+	{
+		if(!tracking || lastBox.area() <= 0)
+			return cv::Rect();
+
+		const cv::Mat& s = kf.statePost;
+		float vx = s.at<float>(3), vy = s.at<float>(4);
+		cv::Point2f next(s.at<float>(0) + vx, s.at<float>(1) + vy);
+		cv::Point shift = next - lastCenter;
+
+		float grow = ROI_PAD * (1 + misses);
+		int padX = lastBox.width * grow + std::abs(vx);
+		int padY = lastBox.height * grow + std::abs(vy);
+
+		return cv::Rect(lastBox.x + shift.x - padX, lastBox.y + shift.y - padY,
+						lastBox.width + 2 * padX, lastBox.height + 2 * padY);
+	}
+};
+
+#endif
@@ -0,0 +1,373 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Distance kernels over contour points kept as a structure of arrays
+	(separate x and y float arrays), so they can be vectorized. They are
+	used to find finger tips, to cut the palm out of the hand contour and
+	to test contours against the face rectangles. sqDistRows does the same
+	for rows of descriptors, for nearest neighbour search. reduceBytes
+	rounds pixel bytes for ColorHistogram::colorReduce.
+
+	AVX2, SSE2 or NEON is chosen at compile time from the compiler flags
+	(e.g. -mavx2), anything else falls back to the scalar loops, which
+	also handle the tails. All distances are squared, no sqrt is taken.
+
+*/
+
+
+#ifndef POINTKERNELS_H
+#define POINTKERNELS_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+#endif
+
+
+// Contour points in structure of arrays form
+struct PointsSoA
+{
+	std::vector<float> x, y;
+
+	// Copies the points over, shifted by offset
+	void assign(const std::vector<cv::Point>& points,
+				cv::Point offset = cv::Point())
+	{
+		x.resize(points.size());
+		y.resize(points.size());
+		for(unsigned int i = 0; i < points.size(); i++)
+		{
+			x[i] = points[i].x + offset.x;
+			y[i] = points[i].y + offset.y;
+		}
+	}
+
+	int size() const
+	{
+		return x.size();
+	}
+};
+
+
+//##############################################################################
+//	Kernels
+
+/*
+	Squared distance of every point from (cx, cy), written to out[0..n)
+*/
+inline void sqDistances(const float* x, const float* y, int n,
+						float cx, float cy, float* out)
+{
+	int i = 0;
+#if defined(__AVX2__)
+	const __m256 vcx = _mm256_set1_ps(cx), vcy = _mm256_set1_ps(cy);
+	for( ; i + 8 <= n; i += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), vcx);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), vcy);
+		_mm256_storeu_ps(out + i,
+			_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+	}
+#elif defined(__SSE2__)
+	const __m128 vcx = _mm_set1_ps(cx), vcy = _mm_set1_ps(cy);
+	for( ; i + 4 <= n; i += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), vcx);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), vcy);
+		_mm_storeu_ps(out + i,
+			_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	const float32x4_t vcx = vdupq_n_f32(cx), vcy = vdupq_n_f32(cy);
+	for( ; i + 4 <= n; i += 4)
+	{
+		float32x4_t dx = vsubq_f32(vld1q_f32(x + i), vcx);
+		float32x4_t dy = vsubq_f32(vld1q_f32(y + i), vcy);
+		vst1q_f32(out + i, vmlaq_f32(vmulq_f32(dx, dx), dy, dy));
+	}
+#endif
+	for( ; i < n; i++)
+	{
+		float dx = x[i] - cx, dy = y[i] - cy;
+		out[i] = dx * dx + dy * dy;
+	}
+}
+
+/*
+	Index of the point farthest from (cx, cy), the first one if several
+	tie, with its squared distance in maxDist2. Returns -1 if n is 0.
+*/
+inline int maxSqDistance(const float* x, const float* y, int n,
+						float cx, float cy, float& maxDist2)
+{
+	int best = -1, i = 0;
+	maxDist2 = -1;
+
+	// each lane keeps its own max and the (float) index where it was seen,
+	// exact for contours up to 2^24 points
+#if defined(__AVX2__)
+	if(n >= 8)
+	{
+		const __m256 vcx = _mm256_set1_ps(cx), vcy = _mm256_set1_ps(cy);
+		const __m256 step = _mm256_set1_ps(8);
+		__m256 vmax = _mm256_set1_ps(-1), vidx = _mm256_setzero_ps();
+		__m256 cur = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+		for( ; i + 8 <= n; i += 8)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), vcx);
+			__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), vcy);
+			__m256 d = _mm256_add_ps(_mm256_mul_ps(dx, dx),
+									_mm256_mul_ps(dy, dy));
+			__m256 gt = _mm256_cmp_ps(d, vmax, _CMP_GT_OQ);
+			vmax = _mm256_blendv_ps(vmax, d, gt);
+			vidx = _mm256_blendv_ps(vidx, cur, gt);
+			cur = _mm256_add_ps(cur, step);
+		}
+		float lmax[8], lidx[8];
+		_mm256_storeu_ps(lmax, vmax);
+		_mm256_storeu_ps(lidx, vidx);
+		for(int l = 0; l < 8; l++)
+		{
+			if(lmax[l] > maxDist2 || (lmax[l] == maxDist2 && lidx[l] < best))
+			{
+				maxDist2 = lmax[l];
+				best = lidx[l];
+			}
+		}
+	}
+#elif defined(__SSE2__)
+	if(n >= 4)
+	{
+		const __m128 vcx = _mm_set1_ps(cx), vcy = _mm_set1_ps(cy);
+		const __m128 step = _mm_set1_ps(4);
+		__m128 vmax = _mm_set1_ps(-1), vidx = _mm_setzero_ps();
+		__m128 cur = _mm_setr_ps(0, 1, 2, 3);
+		for( ; i + 4 <= n; i += 4)
+		{
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), vcx);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), vcy);
+			__m128 d = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+			__m128 gt = _mm_cmpgt_ps(d, vmax);
+			vmax = _mm_or_ps(_mm_and_ps(gt, d), _mm_andnot_ps(gt, vmax));
+			vidx = _mm_or_ps(_mm_and_ps(gt, cur), _mm_andnot_ps(gt, vidx));
+			cur = _mm_add_ps(cur, step);
+		}
+		float lmax[4], lidx[4];
+		_mm_storeu_ps(lmax, vmax);
+		_mm_storeu_ps(lidx, vidx);
+		for(int l = 0; l < 4; l++)
+		{
+			if(lmax[l] > maxDist2 || (lmax[l] == maxDist2 && lidx[l] < best))
+			{
+				maxDist2 = lmax[l];
+				best = lidx[l];
+			}
+		}
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	if(n >= 4)
+	{
+		const float32x4_t vcx = vdupq_n_f32(cx), vcy = vdupq_n_f32(cy);
+		const float32x4_t step = vdupq_n_f32(4);
+		const float init[4] = { 0, 1, 2, 3 };
+		float32x4_t vmax = vdupq_n_f32(-1), vidx = vdupq_n_f32(0);
+		float32x4_t cur = vld1q_f32(init);
+		for( ; i + 4 <= n; i += 4)
+		{
+			float32x4_t dx = vsubq_f32(vld1q_f32(x + i), vcx);
+			float32x4_t dy = vsubq_f32(vld1q_f32(y + i), vcy);
+			float32x4_t d = vmlaq_f32(vmulq_f32(dx, dx), dy, dy);
+			uint32x4_t gt = vcgtq_f32(d, vmax);
+			vmax = vbslq_f32(gt, d, vmax);
+			vidx = vbslq_f32(gt, cur, vidx);
+			cur = vaddq_f32(cur, step);
+		}
+		float lmax[4], lidx[4];
+		vst1q_f32(lmax, vmax);
+		vst1q_f32(lidx, vidx);
+		for(int l = 0; l < 4; l++)
+		{
+			if(lmax[l] > maxDist2 || (lmax[l] == maxDist2 && lidx[l] < best))
+			{
+				maxDist2 = lmax[l];
+				best = lidx[l];
+			}
+		}
+	}
+#endif
+	for( ; i < n; i++)
+	{
+		float dx = x[i] - cx, dy = y[i] - cy;
+		float d = dx * dx + dy * dy;
+		if(d > maxDist2)
+		{
+			maxDist2 = d;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+/*
+	True if any of the points lies inside rect (same test as
+	cv::Rect::contains). Stops at the first block with a hit.
+*/
+inline bool anyInRect(const float* x, const float* y, int n,
+						const cv::Rect& rect)
+{
+	const float x0 = rect.x, x1 = rect.x + rect.width;
+	const float y0 = rect.y, y1 = rect.y + rect.height;
+
+	int i = 0;
+#if defined(__AVX2__)
+	const __m256 vx0 = _mm256_set1_ps(x0), vx1 = _mm256_set1_ps(x1);
+	const __m256 vy0 = _mm256_set1_ps(y0), vy1 = _mm256_set1_ps(y1);
+	for( ; i + 8 <= n; i += 8)
+	{
+		__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i);
+		__m256 in = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(vx, vx0, _CMP_GE_OQ),
+						_mm256_cmp_ps(vx, vx1, _CMP_LT_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(vy, vy0, _CMP_GE_OQ),
+						_mm256_cmp_ps(vy, vy1, _CMP_LT_OQ)));
+		if(_mm256_movemask_ps(in))
+			return true;
+	}
+#elif defined(__SSE2__)
+	const __m128 vx0 = _mm_set1_ps(x0), vx1 = _mm_set1_ps(x1);
+	const __m128 vy0 = _mm_set1_ps(y0), vy1 = _mm_set1_ps(y1);
+	for( ; i + 4 <= n; i += 4)
+	{
+		__m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i);
+		__m128 in = _mm_and_ps(
+			_mm_and_ps(_mm_cmpge_ps(vx, vx0), _mm_cmplt_ps(vx, vx1)),
+			_mm_and_ps(_mm_cmpge_ps(vy, vy0), _mm_cmplt_ps(vy, vy1)));
+		if(_mm_movemask_ps(in))
+			return true;
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	const float32x4_t vx0 = vdupq_n_f32(x0), vx1 = vdupq_n_f32(x1);
+	const float32x4_t vy0 = vdupq_n_f32(y0), vy1 = vdupq_n_f32(y1);
+	for( ; i + 4 <= n; i += 4)
+	{
+		float32x4_t vx = vld1q_f32(x + i), vy = vld1q_f32(y + i);
+		uint32x4_t in = vandq_u32(
+			vandq_u32(vcgeq_f32(vx, vx0), vcltq_f32(vx, vx1)),
+			vandq_u32(vcgeq_f32(vy, vy0), vcltq_f32(vy, vy1)));
+		uint32x2_t any = vorr_u32(vget_low_u32(in), vget_high_u32(in));
+		if(vget_lane_u32(any, 0) | vget_lane_u32(any, 1))
+			return true;
+	}
+#endif
+	for( ; i < n; i++)
+	{
+		if(x[i] >= x0 && x[i] < x1 && y[i] >= y0 && y[i] < y1)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+	Squared distance from q to each of count rows of dim floats, stored
+	one after another in rows, written to out[0..count)
+*/
+inline void sqDistRows(const float* rows, int count, int dim,
+						const float* q, float* out)
+{
+	for(int r = 0; r < count; r++)
+	{
+		const float* row = rows + r * dim;
+		float sum = 0;
+		int j = 0;
+#if defined(__AVX2__)
+		__m256 acc = _mm256_setzero_ps();
+		for( ; j + 8 <= dim; j += 8)
+		{
+			__m256 d = _mm256_sub_ps(_mm256_loadu_ps(row + j),
+									_mm256_loadu_ps(q + j));
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+		}
+		float lanes[8];
+		_mm256_storeu_ps(lanes, acc);
+		for(int l = 0; l < 8; l++)
+			sum += lanes[l];
+#elif defined(__SSE2__)
+		__m128 acc = _mm_setzero_ps();
+		for( ; j + 4 <= dim; j += 4)
+		{
+			__m128 d = _mm_sub_ps(_mm_loadu_ps(row + j), _mm_loadu_ps(q + j));
+			acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+		}
+		float lanes[4];
+		_mm_storeu_ps(lanes, acc);
+		sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+		float32x4_t acc = vdupq_n_f32(0);
+		for( ; j + 4 <= dim; j += 4)
+		{
+			float32x4_t d = vsubq_f32(vld1q_f32(row + j), vld1q_f32(q + j));
+			acc = vmlaq_f32(acc, d, d);
+		}
+		float lanes[4];
+		vst1q_f32(lanes, acc);
+		sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+		for( ; j < dim; j++)
+		{
+			float d = row[j] - q[j];
+			sum += d * d;
+		}
+		out[r] = sum;
+	}
+}
+
+/*
+	dst[i] = (src[i] & mask) + offset for n bytes, src and dst may be the
+	same. With mask clearing the low bits of a power of 2 div and offset
+	div / 2 the sum stays below 256.
+*/
+inline void reduceBytes(const uchar* src, uchar* dst, int n,
+						uchar mask, uchar offset)
+{
+	int i = 0;
+#if defined(__AVX2__)
+	const __m256i vmask = _mm256_set1_epi8((char)mask),
+				voff = _mm256_set1_epi8((char)offset);
+	for( ; i + 32 <= n; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		_mm256_storeu_si256((__m256i*)(dst + i),
+			_mm256_add_epi8(_mm256_and_si256(v, vmask), voff));
+	}
+#elif defined(__SSE2__)
+	const __m128i vmask = _mm_set1_epi8((char)mask),
+				voff = _mm_set1_epi8((char)offset);
+	for( ; i + 16 <= n; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+		_mm_storeu_si128((__m128i*)(dst + i),
+			_mm_add_epi8(_mm_and_si128(v, vmask), voff));
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	const uint8x16_t vmask = vdupq_n_u8(mask), voff = vdupq_n_u8(offset);
+	for( ; i + 16 <= n; i += 16)
+		vst1q_u8(dst + i, vaddq_u8(vandq_u8(vld1q_u8(src + i), vmask), voff));
+#endif
+	for( ; i < n; i++)
+		dst[i] = (src[i] & mask) + offset;
+}
+
+//	END Kernels
+//##############################################################################
+
+#endif
@@ -0,0 +1,190 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	A user's gallery of enrolled gesture templates. Each template is a
+	Fourier descriptor of the hand contour: the contour is resampled to a
+	fixed number of points, transformed, and the magnitudes of the low
+	frequencies (relative to the first) are kept. That makes it invariant
+	to position, rotation, scale and where the contour starts, and the
+	same small size however long the contour is.
+
+	Matching a frame is a nearest neighbour search over the gallery rows
+	with the vectorized sqDistRows kernel.
+
+*/
+
+
+#ifndef TEMPLATEGALLERY_H
+#define TEMPLATEGALLERY_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <cmath>
+
+#include "../include/pointkernels.h"
+
+
+static const int DESCRIPTOR_SIZE = 16,
+				DESCRIPTOR_SAMPLES = 64;
+
+
+/*
+	Fourier descriptor of a closed contour, DESCRIPTOR_SIZE floats:
+	|c[k]| / |c[1]| for k = 2..9 and k = -1..-8. Returns false (and
+	leaves out alone) if the contour is too small to describe.
+*/
+inline bool contourDescriptor(const std::vector<cv::Point>& contour,
+								float out[DESCRIPTOR_SIZE])
+{
+	const int n = contour.size();
+	if(n < 3)
+		return false;
+
+	// perimeter, including the closing edge
+	std::vector<float> cumLen(n + 1, 0);
+	for(int i = 0; i < n; i++)
+	{
+		cv::Point d = contour[(i + 1) % n] - contour[i];
+		cumLen[i + 1] = cumLen[i] + std::sqrt((float)d.dot(d));
+	}
+	const float perimeter = cumLen[n];
+	if(perimeter <= 0)
+		return false;
+
+	// resample at equal arc lengths into a complex signal
+	cv::Mat signal(1, DESCRIPTOR_SAMPLES, CV_32FC2), spectrum;
+	cv::Vec2f* s = signal.ptr<cv::Vec2f>(0);
+	int seg = 0;
+	for(int k = 0; k < DESCRIPTOR_SAMPLES; k++)
+	{
+		float at = perimeter * k / DESCRIPTOR_SAMPLES;
+		while(cumLen[seg + 1] < at)
+			seg++;
+
+		float len = cumLen[seg + 1] - cumLen[seg];
+		float t = len > 0 ? (at - cumLen[seg]) / len : 0;
+		const cv::Point &a = contour[seg], &b = contour[(seg + 1) % n];
+		s[k] = cv::Vec2f(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y));
+	}
+
+	cv::dft(signal, spectrum);
+	const cv::Vec2f* c = spectrum.ptr<cv::Vec2f>(0);
+
+	float base = std::sqrt(c[1][0] * c[1][0] + c[1][1] * c[1][1]);
+	if(base <= 0)
+		return false;
+
+	const int half = DESCRIPTOR_SIZE / 2;
+	for(int k = 0; k < half; k++)
+	{
+		const cv::Vec2f& pos = c[k + 2];
+		const cv::Vec2f& neg = c[DESCRIPTOR_SAMPLES - 1 - k];
+		out[k] = std::sqrt(pos[0] * pos[0] + pos[1] * pos[1]) / base;
+		out[half + k] = std::sqrt(neg[0] * neg[0] + neg[1] * neg[1]) / base;
+	}
+	return true;
+}
+
+
+class TemplateGallery
+{
+
+private:
+	// DESCRIPTOR_SIZE floats per template, one after another
+	std::vector<float> descriptors;
+	std::vector<int> labels;
+
+	// scratch for the distances of the last match
+	mutable std::vector<float> dists;
+
+
+	static const int MAX_PER_LABEL = 8;
+
+public:
+	// Squared descriptor distance under which a match is trusted
+	static constexpr float MAX_MATCH_DIST2 = 0.05f;
+
+	int size() const
+	{
+		return labels.size();
+	}
+
+	bool empty() const
+	{
+		return labels.empty();
+	}
+
+	void clear()
+	{
+		descriptors.clear();
+		labels.clear();
+	}
+
+	int countFor(int label) const
+	{
+		int count = 0;
+		for(int l : labels)
+			count += l == label;
+		return count;
+	}
+
+	const std::vector<float>& getDescriptors() const
+	{
+		return descriptors;
+	}
+
+	const std::vector<int>& getLabels() const
+	{
+		return labels;
+	}
+
+	/*
+		Adds a template for label (a HandType). Once a label has
+		MAX_PER_LABEL templates its oldest one is replaced.
+	*/
+	void enroll(const float d[DESCRIPTOR_SIZE], int label)
+	{
+		if(countFor(label) >= MAX_PER_LABEL)
+		{
+			for(unsigned int i = 0; i < labels.size(); i++)
+			{
+				if(labels[i] != label)
+					continue;
+				labels.erase(labels.begin() + i);
+				descriptors.erase(descriptors.begin() + i * DESCRIPTOR_SIZE,
+							descriptors.begin() + (i + 1) * DESCRIPTOR_SIZE);
+				break;
+			}
+		}
+
+		labels.push_back(label);
+		descriptors.insert(descriptors.end(), d, d + DESCRIPTOR_SIZE);
+	}
+
+	/*
+		Label of the closest template, -1 if the gallery is empty. Its
+		squared distance is returned in dist2.
+	*/
+	int nearest(const float d[DESCRIPTOR_SIZE], float& dist2) const
+	{
+		dist2 = -1;
+		if(labels.empty())
+			return -1;
+
+		dists.resize(labels.size());
+		sqDistRows(&descriptors[0], labels.size(), DESCRIPTOR_SIZE, d,
+					&dists[0]);
+
+		int best = 0;
+		for(unsigned int i = 1; i < dists.size(); i++)
+			if(dists[i] < dists[best])
+				best = i;
+
+		dist2 = dists[best];
+		return labels[best];
+	}
+};
+
+#endif
@@ -13,8 +13,17 @@
 #define PI 3.1415926
 
 #include <string>
-#include <deque>
 #include "../include/hand.h"
+#include "../include/palmtracker.h"
+#include "../include/motiongesture.h"
+#include "../include/gesturemodel.h"
+#include "../include/templategallery.h"
+#include "../include/userprofile.h"
+#ifdef GESTURE_COMPILED_MODEL
+#include "../include/gesturetree.h"
+static_assert(GESTURE_TREE_NODES > 0, "kiosk build without a compiled gesture "
+			"model, regenerate include/gesturetree.h with tools/gesturegen");
+#endif
 
 
 enum Direction{
@@ -40,8 +49,31 @@ public:
 	Finger pinky;
 
 	Hand curHand;
-	std::deque<double> palmRadii;
-	std::deque<cv::Point2f> palmCenters;
+	// features of curHand, their type is the FIST/PALM class classify()
+	// refined, so they can be logged and replayed as the classifier saw them
+	HandFeatures curFeatures;
+	// smooths the palm between frames and predicts where the hand is next
+	PalmTracker palmTracker;
+
+	// trained classifier, replaces palmClass/fistClass once loaded
+	GestureModel model;
+
+	// this user's own examples of the goal gestures
+	TemplateGallery gallery;
+
+	// recent palm and fingertip positions, and the motions found in them
+	// (copies start a fresh trajectory)
+	Trajectory trajectory;
+	MotionRecognizer motionRecognizer;
+	MotionType lastMotion = MOTION_NONE;
+	double lastMotionMs = 0;
+
+	// time of the frame being processed (see setFrameTime), in ms
+	double frameMs = 0;
+
+	// motion steps are measured per 1/30 s, longer gaps break a motion
+	static constexpr double MOTION_FRAME_MS = 1000.0 / 30,
+							MOTION_MAX_GAP_MS = 250;
 
 
 	double c2eSLOPE;
@@ -51,10 +83,6 @@ public:
 	//Constructor
 	User()
 	{
-		for(int i = 0; i < 3; i++)
-		{
-			palmRadii[i] = 0;
-		}
 		orient = LEFT;
 	}
 
@@ -65,7 +93,6 @@ public:
 		spread = h.spread;
 		curHand = h.curHand;
 
-		palmRadii = h.palmRadii;
 		c2eSLOPE = h.c2eSLOPE;
 		c2bSLOPE = h.c2bSLOPE;
 		orient = h.orient;
@@ -77,6 +104,8 @@ public:
 		pinky = h.pinky;
 
 		sigSlope = h.sigSlope;
+		model = h.model;
+		gallery = h.gallery;
 	}
 
 	//assignment operator
@@ -86,7 +115,6 @@ public:
 		spread = rhs.spread;
 		curHand = rhs.curHand;
 
-		palmRadii = rhs.palmRadii;
 		c2eSLOPE = rhs.c2eSLOPE;
 		c2bSLOPE = rhs.c2bSLOPE;
 		orient = rhs.orient;
@@ -98,6 +126,8 @@ public:
 		pinky = rhs.pinky;
 
 		sigSlope = rhs.sigSlope;
+		model = rhs.model;
+		gallery = rhs.gallery;
 
 		return *this;
 	}
@@ -161,18 +191,156 @@ public:
 	{
 		curHand = hand;
         if(curHand.isNone())
+		{
+			palmTracker.miss();
 			return;
+		}
 		
-		radiusSmoothing();
-		centerSmoothing();
+		palmSmoothing();
 
 		curHand.findFingers();
 		curHand.findClass();
 
-		if(curHand.type == FIST)
-			fistClass();
-		else if (curHand.type == PALM)
-			palmClass();
+		// summarise once, everything downstream works off the features
+		curFeatures = curHand.getFeatures();
+		curHand.type = classify(curFeatures);
+		matchGallery();
+		trackMotion();
+	}
+
+	/*
+		Sets the time of the frame about to be processed, in ms from the
+		frame source (a recording's own clock), before setCurHand
+	*/
+	void setFrameTime(double ms)
+	{
+		frameMs = ms;
+	}
+
+	/*
+		Adds the current hand to the trajectory and feeds its step since
+		the last one to the motion recognizer. Steps are scaled to palm
+		radii per 1/30 s, a long enough gap breaks any motion in progress.
+	*/
+	void trackMotion()
+	{
+		TrajectorySample s;
+		s.ms = frameMs;
+		s.palmX = curFeatures.palmX;
+		s.palmY = curFeatures.palmY;
+		s.palmRadius = curFeatures.palmRadius;
+		s.numTips = std::min(curFeatures.numFingers,
+							(int)HandFeatures::MAX_FINGERS);
+		std::copy(curFeatures.tipX, curFeatures.tipX + s.numTips, s.tipX);
+		std::copy(curFeatures.tipY, curFeatures.tipY + s.numTips, s.tipY);
+		if(s.palmRadius <= 0)
+			return;
+
+		if(!trajectory.empty())
+		{
+			const TrajectorySample& prev = trajectory.back();
+			double dt = s.ms - prev.ms;
+			if(dt > MOTION_MAX_GAP_MS)
+				motionRecognizer.reset();
+			else if(dt > 0)
+			{
+				float scale = MOTION_FRAME_MS / dt / s.palmRadius;
+				cv::Point2f palm((s.palmX - prev.palmX) * scale,
+								(s.palmY - prev.palmY) * scale);
+
+				int a = highestTip(prev), b = highestTip(s);
+				cv::Point2f tip;
+				if(a >= 0 && b >= 0)
+					tip = cv::Point2f((s.tipX[b] - prev.tipX[a]) * scale,
+									(s.tipY[b] - prev.tipY[a]) * scale);
+
+				MotionType m = motionRecognizer.update(&palm,
+											a >= 0 && b >= 0 ? &tip : 0);
+				if(m != MOTION_NONE)
+				{
+					lastMotion = m;
+					lastMotionMs = s.ms;
+				}
+			}
+		}
+		trajectory.push(s);
+	}
+
+	// The last motion recognized, if it was within the last withinMs
+	MotionType recentMotion(double withinMs = 1000)
+	{
+		if(lastMotion == MOTION_NONE || frameMs - lastMotionMs > withinMs)
+			return MOTION_NONE;
+		return lastMotion;
+	}
+
+	// Draws the palm's recent path onto img
+	void drawTrajectory(cv::Mat img) const
+	{
+		if(img.empty())
+			return;
+
+		for(int i = 1; i < trajectory.size(); i++)
+		{
+			const TrajectorySample &a = trajectory.at(i - 1),
+								&b = trajectory.at(i);
+			if(b.ms - a.ms > MOTION_MAX_GAP_MS)
+				continue;
+			cv::line(img, cv::Point(a.palmX, a.palmY),
+					cv::Point(b.palmX, b.palmY), HALF_GREEN, 2);
+		}
+	}
+
+	// A close enough match to one of the user's templates overrides the
+	// generic classification
+	void matchGallery()
+	{
+		float d[DESCRIPTOR_SIZE], dist2;
+		if(gallery.empty() || !contourDescriptor(curHand.contour[0], d))
+			return;
+
+		int label = gallery.nearest(d, dist2);
+		if(dist2 <= TemplateGallery::MAX_MATCH_DIST2)
+			curHand.type = (HandType)label;
+	}
+
+	// Enrolls the current hand as a template of gesture, returns false if
+	// there is no usable hand
+	bool enrollTemplate(const std::string& gesture)
+	{
+		float d[DESCRIPTOR_SIZE];
+		if(curHand.isNone() || !contourDescriptor(curHand.contour[0], d))
+			return false;
+
+		gallery.enroll(d, Hand::translateType(gesture));
+		return true;
+	}
+
+	// Refine a FIST or PALM into a gesture using only the features
+	HandType classify(const HandFeatures& f)
+	{
+#ifdef GESTURE_COMPILED_MODEL
+		if(f.type == FIST || f.type == PALM)
+		{
+			float calib[5], x[GESTURE_FEATURES];
+			calibratedAngles(calib);
+			gestureFeatures(f, calib, isLeft(), x);
+			return (HandType)compiledGestureClass(x);
+		}
+#endif
+		if(model.isLoaded() && (f.type == FIST || f.type == PALM))
+		{
+			float calib[5], x[GESTURE_FEATURES];
+			calibratedAngles(calib);
+			gestureFeatures(f, calib, isLeft(), x);
+			return (HandType)model.classify(x);
+		}
+
+		if(f.type == FIST)
+			return fistClass(f);
+		else if(f.type == PALM)
+			return palmClass(f);
+		return (HandType)f.type;
 	}
 
 	double calcSlope(cv::Point a, cv::Point b)
@@ -183,64 +351,44 @@ public:
 		return slope;
 	}
 
-	void fistClass()
-	{		
-		std::vector<cv::Point> contour = curHand.contour[0];
-
-		int c = 0;
-		int b = 5;
-		int e = contour.size()-5;
-		int max = contour.size()/2;
-
-		int search = 1;
+	HandType fistClass(const HandFeatures& f)
+	{
+		// contour too short to measure, leave it as a fist
+		if(!f.hasSlopes)
+			return FIST;
 
-		while((b < max) && search)
+		switch(orient)
 		{
-			switch(orient)
-			{
-				case LEFT:
-					c2eSLOPE = calcSlope(contour[c], contour[e]);
-					sigSlope = c2eSLOPE;
-					if(c2eSLOPE > 0.5)
-						curHand.type = T;  //EXPAND
-					else
-						curHand.type = A;
-					search = 0;
-					break;
-				case RIGHT:
-					c2bSLOPE = calcSlope(contour[c], contour[b]);
-					sigSlope = c2bSLOPE;
-					if(c2bSLOPE < -0.70)
-						curHand.type = T; //EXPAND
-					else
-						curHand.type = A;
-					search = 0;
-					break;			
-				default:
-					curHand.type = FIST;
-					break;
-			}
-
-			b = b+5;
-			e = e-5;
+			case LEFT:
+				c2eSLOPE = f.c2eSlope;
+				sigSlope = c2eSLOPE;
+				if(c2eSLOPE > 0.5)
+					return T;  //EXPAND
+				return A;
+			case RIGHT:
+				c2bSLOPE = f.c2bSlope;
+				sigSlope = c2bSLOPE;
+				if(c2bSLOPE < -0.70)
+					return T; //EXPAND
+				return A;
+			default:
+				return FIST;
 		}
-		
 	}
 
-	void palmClass()
+	HandType palmClass(const HandFeatures& f)
 	{
-		int count = curHand.fingers.size();
+		int count = f.numFingers;
 
 		if(count == 1)
 		{
-			curHand.type = I;
-			
+			return I;
 		}
 		else if(count == 2)
 		{
-			std::vector<Finger> fingers = curHand.fingers;
+			const float *angles = f.fingerAngles;
 
-			double subAngle = std::abs(fingers[0].angle - fingers[1].angle);
+			double subAngle = std::abs(angles[0] - angles[1]);
             //qDebug() << "subAngle: " << subAngle;
 
 			double subVind2mid = std::abs(subAngle - std::abs(index.angle-middle.angle));
@@ -253,38 +401,81 @@ public:
 
 			if(subVind2mid < subVthumb2pink)
 			{
-//                if((subVind2mid < subVthumb2ind))
-//                        curHand.type = V;
-//                else
-//                {
-                    if((fingers[0].angle > 2.2) || (fingers[1].angle > 2.2)
-                        || (fingers[0].angle < 0.5) || (fingers[1].angle < 0.5))
-                            curHand.type = L;
-                    else
-                        curHand.type = V;
-//                 }
-
+                if((angles[0] > 2.2) || (angles[1] > 2.2)
+                    || (angles[0] < 0.5) || (angles[1] < 0.5))
+                        return L;
+                return V;
 			}
 			else if(subVthumb2pink < subVthumb2ind)
-				curHand.type = Y;
+				return Y;
 			else
-				curHand.type = V;
-            
-			// if(((thumb2pink-0.5) < subAngle) && (subAngle < (thumb2pink+0.5)))
-			// 	curHand.type = Y;
-			// else if(((thumb2ind-0.5) < subAngle) && (subAngle < (thumb2ind+0.5)))
-			// 	curHand.type = L;
-			// if(((ind2mid-0.2) < subAngle) && (subAngle < (ind2mid+0.2)))
-			// 	curHand.type = V;
-			
+				return V;
 		}
 		else if(count == 3)
 		{
-			curHand.type = W;
+			return W;
 		}
-		else 
-			curHand.type = PALM;
 
+		return PALM;
+	}
+
+	// Loads a trained model, the hardcoded rules are used until one is
+	bool loadModel(const std::string& filename)
+	{
+		static_assert(GESTURE_MAX_LABEL == NONE,
+					"GESTURE_MAX_LABEL must follow HandType");
+		return model.load(filename);
+	}
+
+	// Sets the calibration without measuring, e.g. from a dataset
+	void setCalibration(const float angles[5], bool left)
+	{
+		thumb.angle = angles[0];
+		index.angle = angles[1];
+		middle.angle = angles[2];
+		ring.angle = angles[3];
+		pinky.angle = angles[4];
+		setLeft(left);
+	}
+
+	// The calibrated thumb, index, middle, ring and pinky angles
+	void calibratedAngles(float out[5]) const
+	{
+		out[0] = thumb.angle;
+		out[1] = index.angle;
+		out[2] = middle.angle;
+		out[3] = ring.angle;
+		out[4] = pinky.angle;
+	}
+
+	// Fills in the calibration and templates of p (not its name or location)
+	void getProfile(UserProfile& p) const
+	{
+		p.left = orient == LEFT;
+		calibratedAngles(p.angles);
+		p.fist = fist.isNone() ? std::vector<cv::Point>() : fist.getContour();
+		p.spread = spread.isNone() ? std::vector<cv::Point>() :
+									spread.getContour();
+		p.labels = gallery.getLabels();
+		p.descriptors = gallery.getDescriptors();
+		p.descriptorSize = DESCRIPTOR_SIZE;
+	}
+
+	/*
+		Takes the calibration and templates of a saved profile, the
+		measured hands are found again from their contours with params.
+	*/
+	void setProfile(const UserProfile& p,
+					const DetectorParams& params = DetectorParams())
+	{
+		fist = p.fist.empty() ? Hand() : Hand(p.fist, params);
+		spread = p.spread.empty() ? Hand() : Hand(p.spread, params);
+		setCalibration(p.angles, p.left);
+
+		gallery.clear();
+		if(p.descriptorSize == DESCRIPTOR_SIZE)
+			for(unsigned int i = 0; i < p.labels.size(); i++)
+				gallery.enroll(&p.descriptors[i * DESCRIPTOR_SIZE], p.labels[i]);
 	}
 
 	bool contComparing(std::string goal)
@@ -316,45 +507,33 @@ public:
 
 	}
 
-	void radiusSmoothing()
+	// Replaces the measured palm with the tracked one. Hands where no palm
+	// was found keep their (empty) palm and count as a miss.
+	void palmSmoothing()
 	{
-		palmRadii.push_back(curHand.palmRadius);
-
-
-		if(palmRadii.size() > 3)
-			palmRadii.pop_front();
-
-		double localRadius = 0;
-		for(int i = 0; i < 3; i++)
-			localRadius += palmRadii[i] * (i+1);
-
-		localRadius = localRadius / 6;
-
-		curHand.palmRadius = localRadius;
-		curHand.palmArea = PI * (localRadius * localRadius);
+		if(curHand.palmRadius <= 0)
+		{
+			palmTracker.miss();
+			return;
+		}
 
+		palmTracker.update(curHand.palmCenter, curHand.palmRadius,
+							curHand.boxRect);
+		curHand.palmArea = PI * (curHand.palmRadius * curHand.palmRadius);
 	}
 
-	void centerSmoothing()
+	// Where to look for the hand next frame, empty to search everywhere
+	cv::Rect predictedROI() const
 	{
-		palmCenters.push_back(curHand.palmCenter);
-
-
-		if(palmCenters.size() > 3)
-			palmCenters.pop_front();
-
-		cv::Point2f localCenter;
-		for(int i = 0; i < 3; i++)
-			localCenter += palmCenters[i] * (i+1);
-
-		// qDebug() << "new: "<< localCenter.x << ", " << localCenter.y;
-		//!!!!!!!!!!//
-		localCenter.x /= 6;
-		localCenter.y /= 6;
-		// qDebug() << "new: "<< localCenter.x << ", " << localCenter.y
-		// 	<<"  old: " <<curHand.palmCenter.x << ", " << curHand.palmCenter.y;
+		return palmTracker.predictROI();
+	}
 
-		curHand.palmCenter = localCenter;
+	void resetTracking()
+	{
+		palmTracker.reset();
+		trajectory.clear();
+		motionRecognizer.reset();
+		lastMotion = MOTION_NONE;
 	}
 	
 
@@ -0,0 +1,245 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	A trainee's saved calibration, so a returning user can skip the
+	measure tab: the hand's orientation and finger angles, the fist and
+	spread hand contours they were measured from, the location preset
+	(and its HSV range) and the enrolled gesture templates.
+
+	Profiles are kept in a ProfileStore directory, one binary file per
+	name, plus the name of the last one used. A file is a fixed header
+	followed by its arrays (native byte order):
+
+		header		magic, orientation, finger angles, HSV range, and
+					the length of each array
+		arrays		name, location name, fist and spread contours,
+					template labels and descriptors
+
+	Kept free of user.h and hand.h, User converts to and from it.
+
+*/
+
+
+#ifndef USERPROFILE_H
+#define USERPROFILE_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <stdint.h>
+
+#include <QDir>
+#include <QStringList>
+
+
+struct UserProfile
+{
+	std::string name;
+	bool left;
+	// thumb, index, middle, ring and pinky
+	float angles[5];
+
+	std::string location;
+	cv::Scalar hsvMin, hsvMax;
+
+	// contours of the measured fist and spread hand, empty if not measured
+	std::vector<cv::Point> fist, spread;
+
+	// TemplateGallery contents, descriptorSize floats per label
+	std::vector<int> labels;
+	std::vector<float> descriptors;
+	int descriptorSize;
+
+	UserProfile() : left(false), descriptorSize(0)
+	{
+		for(int i = 0; i < 5; i++)
+			angles[i] = 0;
+	}
+};
+
+
+class ProfileStore
+{
+
+private:
+	std::string dir;
+
+
+	struct Header
+	{
+		uint32_t magic;
+		int32_t left;
+		float angles[5];
+		int32_t hsv[6];
+		uint32_t nameLength, locationLength, fistPoints, spreadPoints,
+				templates, descriptorSize;
+	};
+
+	static const uint32_t MAGIC = 0x31505447; // "GTP1"
+	// sanity limit on any array, a profile is a few kilobytes
+	static const uint32_t MAX_LENGTH = 1 << 20;
+
+
+	template<typename T>
+	static void writeArray(std::ofstream& out, const std::vector<T>& v)
+	{
+		if(!v.empty())
+			out.write((const char*)&v[0], v.size() * sizeof(T));
+	}
+
+	template<typename T>
+	static bool readArray(std::ifstream& in, std::vector<T>& v, uint32_t n)
+	{
+		if(n > MAX_LENGTH)
+			return false;
+		v.resize(n);
+		if(n)
+			in.read((char*)&v[0], n * sizeof(T));
+		return (bool)in;
+	}
+
+	static bool readString(std::ifstream& in, std::string& s, uint32_t n)
+	{
+		std::vector<char> chars;
+		if(!readArray(in, chars, n))
+			return false;
+		s.assign(chars.begin(), chars.end());
+		return true;
+	}
+
+	std::string lastFile() const
+	{
+		return dir + "/last";
+	}
+
+public:
+	ProfileStore() {}
+
+	explicit ProfileStore(const std::string& directory)
+	{
+		open(directory);
+	}
+
+	// Uses directory for the profiles, creating it if needed
+	bool open(const std::string& directory)
+	{
+		dir = directory;
+		return QDir().mkpath(dir.c_str());
+	}
+
+	std::string path(const std::string& name) const
+	{
+		return dir + "/" + name + ".profile";
+	}
+
+	// Whether name can be saved under, it becomes part of a file name
+	static bool validName(const std::string& name)
+	{
+		return !name.empty() && name.find_first_of("/\\") == std::string::npos;
+	}
+
+	// Names of the saved profiles, sorted
+	std::vector<std::string> names() const
+	{
+		std::vector<std::string> result;
+		QStringList files = QDir(dir.c_str()).entryList(
+					QStringList("*.profile"), QDir::Files, QDir::Name);
+		for(int i = 0; i < files.size(); i++)
+			result.push_back(files[i].left(files[i].size() - 8).toStdString());
+		return result;
+	}
+
+	bool load(const std::string& name, UserProfile& p) const
+	{
+		std::ifstream in(path(name).c_str(), std::ios::binary);
+		Header h;
+		if(!in.read((char*)&h, sizeof(h)) || h.magic != MAGIC)
+			return false;
+
+		UserProfile loaded;
+		loaded.left = h.left;
+		for(int i = 0; i < 5; i++)
+			loaded.angles[i] = h.angles[i];
+		loaded.hsvMin = cv::Scalar(h.hsv[0], h.hsv[1], h.hsv[2]);
+		loaded.hsvMax = cv::Scalar(h.hsv[3], h.hsv[4], h.hsv[5]);
+		loaded.descriptorSize = h.descriptorSize;
+
+		if(!readString(in, loaded.name, h.nameLength) ||
+			!readString(in, loaded.location, h.locationLength) ||
+			!readArray(in, loaded.fist, h.fistPoints) ||
+			!readArray(in, loaded.spread, h.spreadPoints) ||
+			!readArray(in, loaded.labels, h.templates) ||
+			h.templates * (uint64_t)h.descriptorSize > MAX_LENGTH ||
+			!readArray(in, loaded.descriptors, h.templates * h.descriptorSize))
+			return false;
+
+		p = loaded;
+		return true;
+	}
+
+	// Writes the profile under its name, replacing the old one whole
+	bool save(const UserProfile& p) const
+	{
+		if(!validName(p.name) ||
+			p.labels.size() * p.descriptorSize != p.descriptors.size())
+			return false;
+
+		Header h;
+		h.magic = MAGIC;
+		h.left = p.left;
+		for(int i = 0; i < 5; i++)
+			h.angles[i] = p.angles[i];
+		for(int i = 0; i < 3; i++)
+		{
+			h.hsv[i] = cvRound(p.hsvMin[i]);
+			h.hsv[3 + i] = cvRound(p.hsvMax[i]);
+		}
+		h.nameLength = p.name.size();
+		h.locationLength = p.location.size();
+		h.fistPoints = p.fist.size();
+		h.spreadPoints = p.spread.size();
+		h.templates = p.labels.size();
+		h.descriptorSize = p.descriptorSize;
+
+		// written aside and renamed, so a crash never leaves half a profile
+		std::string file = path(p.name), tmp = file + ".tmp";
+		{
+			std::ofstream out(tmp.c_str(), std::ios::binary);
+			out.write((const char*)&h, sizeof(h));
+			out.write(p.name.data(), p.name.size());
+			out.write(p.location.data(), p.location.size());
+			writeArray(out, p.fist);
+			writeArray(out, p.spread);
+			writeArray(out, p.labels);
+			writeArray(out, p.descriptors);
+			if(!out.flush())
+			{
+				out.close();
+				std::remove(tmp.c_str());
+				return false;
+			}
+		}
+		return std::rename(tmp.c_str(), file.c_str()) == 0;
+	}
+
+	// The profile used last, empty if there is none
+	std::string last() const
+	{
+		std::ifstream in(lastFile().c_str());
+		std::string name;
+		std::getline(in, name);
+		return name;
+	}
+
+	void setLast(const std::string& name) const
+	{
+		std::ofstream out(lastFile().c_str());
+		out << name << "\n";
+	}
+};
+
+#endif
@@ -4,8 +4,19 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
+
+    // frames from a recording instead of the camera (see framesource.h)
+    std::string source;
+    int at = a.arguments().indexOf("--source");
+    if(at >= 0 && at + 1 < a.arguments().size())
+        source = a.arguments().at(at + 1).toStdString();
+
+    MainWindow w(0, source);
     w.show();
 
+    // time from launch to the first processed frame, then quit
+    if(a.arguments().contains("--startup-benchmark"))
+        w.benchmarkStartup();
+
     return a.exec();
 }
@@ -0,0 +1,282 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	The GestureTrainer recognition pipeline for the offline tools: skin
+	mask, hand, classification, on one frame at a time. Every pipeline
+	owns its own detectors and user (the app's singleton controllers are
+	not used), so several can run on separate threads.
+
+	Frames are treated as unrelated, all tracking and reuse of the last
+	hand is reset before each one.
+
+	With a StageCache set, dataset frames are run stage by stage and each
+	stage's result is looked up before it is computed, only classification
+	always runs.
+
+*/
+
+
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "../../include/user.h"
+#include "../../include/gesturedataset.h"
+#include "../../detectors/skindetector.h"
+#include "../../detectors/handdetector.h"
+#include "stagecache.h"
+
+
+// Bump a stage's version when its code changes, so results cached by the
+// old code are not used
+static const int MASK_STAGE_VERSION = 1,
+				CONTOUR_STAGE_VERSION = 1,
+				FEATURES_STAGE_VERSION = 1;
+
+
+class FramePipeline
+{
+
+private:
+	SkinDetector skinDetector;
+	HandDetector handDetector;
+	User user;
+
+	DetectorParams params;
+
+	// scratch, reused between frames, and the last skin mask
+	cv::Mat hsv, mask;
+
+	// shared between pipelines, not owned
+	StageCache* cache;
+	std::vector<char> bytes;
+
+
+	static bool readFile(const std::string& path, std::vector<char>& bytes)
+	{
+		std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+		if(!in)
+			return false;
+		bytes.resize(in.tellg());
+		in.seekg(0);
+		if(!bytes.empty())
+			in.read(&bytes[0], bytes.size());
+		return (bool)in && !bytes.empty();
+	}
+
+	// Parameters of each stage, chained onto the key of the one before
+	uint64_t maskKey(uint64_t frameKey)
+	{
+		cv::Scalar min, max;
+		skinDetector.getThreshold(min, max);
+		uint64_t key = StageCache::chain(frameKey, MASK_STAGE_VERSION);
+		for(int i = 0; i < 3; i++)
+		{
+			key = StageCache::chain(key, min[i]);
+			key = StageCache::chain(key, max[i]);
+		}
+		key = StageCache::chain(key, skinDetector.getInvert());
+		key = StageCache::chain(key, skinDetector.getErode());
+		key = StageCache::chain(key, skinDetector.getDilate());
+		key = StageCache::chain(key, skinDetector.getBlur());
+		key = StageCache::chain(key, params.colorReduce);
+		return StageCache::chain(key, params.morphSize);
+	}
+
+	uint64_t contourKey(uint64_t maskKey)
+	{
+		uint64_t key = StageCache::chain(maskKey, CONTOUR_STAGE_VERSION);
+		key = StageCache::chain(key, params.minHandSize);
+		return StageCache::chain(key, FACEFILE);
+	}
+
+	uint64_t featuresKey(uint64_t contourKey)
+	{
+		float calib[5];
+		user.calibratedAngles(calib);
+		uint64_t key = StageCache::chain(contourKey, FEATURES_STAGE_VERSION);
+		key = StageCache::hash(calib, sizeof(calib), key);
+		key = StageCache::chain(key, user.isLeft());
+		key = StageCache::chain(key, params.minDefectSize);
+		key = StageCache::chain(key, params.minTipRatio);
+		key = StageCache::chain(key, params.maxFingerRatio);
+		key = StageCache::chain(key, params.retryRadius);
+		return StageCache::chain(key, sizeof(HandFeatures));
+	}
+
+	/*
+		Runs a dataset frame through the pipeline one cached stage at a
+		time. Keys only depend on the frame and the parameters, so the
+		latest cached stage is found first and only the stages after it
+		are run. The frame is only decoded if a stage needs it.
+	*/
+	bool processCached(const std::string& path, bool isMask, HandType& type)
+	{
+		if(!readFile(path, bytes))
+			return false;
+		cv::Mat encoded(1, bytes.size(), CV_8U, &bytes[0]), img;
+
+		const uint64_t frameKey = StageCache::chain(
+				StageCache::hash(&bytes[0], bytes.size()), isMask);
+		const uint64_t mKey = maskKey(frameKey),
+					cKey = contourKey(mKey),
+					fKey = featuresKey(cKey);
+
+		HandFeatures features;
+		if(!cache->getFeatures(fKey, features))
+		{
+			std::vector<cv::Point> contour;
+			if(!cache->getContour(cKey, contour))
+			{
+				// skin mask, a mask frame is its own
+				if(isMask)
+					mask = cv::imdecode(encoded, 0);
+				else if(!cache->getMask(mKey, mask))
+				{
+					img = cv::imdecode(encoded, 1);
+					if(img.empty())
+						return false;
+					cv::cvtColor(img, hsv, CV_BGR2HSV);
+					mask = skinDetector.processHSV(hsv);
+					cache->putMask(mKey, mask);
+				}
+				if(mask.empty())
+					return false;
+
+				// hand contour, the face check wants a color image
+				cv::Mat color;
+				if(isMask)
+					cv::cvtColor(mask, color, CV_GRAY2BGR);
+				else
+					color = img.empty() ? cv::imdecode(encoded, 1) : img;
+				if(color.empty())
+					return false;
+
+				handDetector.reset();
+				handDetector.findHand(color, mask);
+				if(!handDetector.getLastHand().isNone())
+					contour = handDetector.getLastHand().getContour();
+				cache->putContour(cKey, contour);
+			}
+
+			// features, as User::setCurHand takes them
+			user.resetTracking();
+			user.setCurHand(contour.empty() ? Hand() : Hand(contour, params));
+			features = user.curFeatures;
+			if(user.curHand.isNone())
+				features.type = NONE;
+			cache->putFeatures(fKey, features);
+		}
+
+		type = features.type == NONE ? NONE : user.classify(features);
+		return true;
+	}
+
+public:
+	FramePipeline() : cache(0) {}
+
+	// Caches stage results in c from now on (0 for none)
+	void setCache(StageCache* c)
+	{
+		cache = c;
+	}
+
+	void setParams(const DetectorParams& p)
+	{
+		params = p;
+		skinDetector.setParams(p);
+		handDetector.setParams(p);
+	}
+
+	// Loads a gesture model to classify with, the rules are used without
+	bool loadModel(const std::string& filename)
+	{
+		return user.loadModel(filename);
+	}
+
+	// Takes on a dataset user's calibration and skin range
+	void setUser(const DatasetUser& u)
+	{
+		user.setCalibration(u.angles, u.left);
+		skinDetector.setThreshold(u.hsvMin, u.hsvMax);
+	}
+
+	/*
+		Runs a color (BGR) frame, or an already thresholded mask, through
+		the pipeline. Returns the class found, NONE if there is no hand.
+	*/
+	HandType process(const cv::Mat& frame, bool isMask)
+	{
+		if(!isMask)
+		{
+			cv::cvtColor(frame, hsv, CV_BGR2HSV);
+			return processHSV(frame, hsv);
+		}
+
+		// the face check wants a color image, even for a mask
+		cv::Mat color;
+		cv::cvtColor(frame, color, CV_GRAY2BGR);
+		return processMask(color, frame);
+	}
+
+	// The same from a frame already converted to HSV, so one conversion
+	// can be shared by several pipelines
+	HandType processHSV(const cv::Mat& color, const cv::Mat& hsvImg)
+	{
+		return processMask(color, skinDetector.processHSV(hsvImg));
+	}
+
+	// The same from the skin mask on
+	HandType processMask(const cv::Mat& color, const cv::Mat& skin)
+	{
+		mask = skin;
+		handDetector.reset();
+		handDetector.findHand(color, mask);
+
+		user.resetTracking();
+		user.setCurHand(handDetector.getLastHand());
+		return user.curHand.isNone() ? NONE : user.curHand.type;
+	}
+
+	// Loads and processes a dataset frame, false if it cannot be read
+	bool process(const GestureDataset& dataset, const DatasetFrame& frame,
+					HandType& type)
+	{
+		if(cache)
+		{
+			setUser(dataset.getUsers()[frame.user]);
+			return processCached(dataset.framePath(frame), frame.isMask, type);
+		}
+
+		cv::Mat img = cv::imread(dataset.framePath(frame),
+									frame.isMask ? 0 : 1);
+		if(img.empty())
+			return false;
+
+		setUser(dataset.getUsers()[frame.user]);
+		type = process(img, frame.isMask);
+		return true;
+	}
+
+	// The user and skin mask of the last frame processed, only up to date
+	// without a cache
+	const User& getUser() const
+	{
+		return user;
+	}
+
+	const cv::Mat& getMask() const
+	{
+		return mask;
+	}
+};
+
+#endif
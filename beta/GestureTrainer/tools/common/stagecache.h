@@ -0,0 +1,213 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	An on disk cache of the pipeline's intermediate results, so re-running
+	an evaluation only redoes the stages that changed. Each stage's result
+	is stored under a key that hashes everything it depends on: the key of
+	the stage before it plus the stage's own parameters. Changing a late
+	stage (or just the classification, which is never cached) leaves the
+	keys, and so the cached results, of the early stages alone.
+
+	Results are files named by their key, <dir>/<stage>/<key in hex>.
+	Keys are 64 bit FNV-1a hashes. The cache is safe to share between
+	threads: every file is written to a temporary name and renamed into
+	place.
+
+*/
+
+
+#ifndef STAGECACHE_H
+#define STAGECACHE_H
+
+#include <QDir>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <stdint.h>
+
+#include "../../include/handfeatures.h"
+
+
+class StageCache
+{
+
+public:
+	enum Stage {
+		// skin mask of a frame
+		MASK,
+		// the hand contour chosen from the mask, empty if there is none
+		CONTOUR,
+		// the HandFeatures of that contour
+		FEATURES,
+
+		NUM_STAGES
+	};
+
+	static const uint64_t FNV_OFFSET = 14695981039346656037ULL,
+						FNV_PRIME = 1099511628211ULL;
+
+	static uint64_t hash(const void* data, size_t size,
+						uint64_t h = FNV_OFFSET)
+	{
+		const uchar* p = (const uchar*)data;
+		for(size_t i = 0; i < size; i++)
+			h = (h ^ p[i]) * FNV_PRIME;
+		return h;
+	}
+
+	// Extends key with a parameter (any plain value)
+	template<typename T>
+	static uint64_t chain(uint64_t key, const T& value)
+	{
+		return hash(&value, sizeof(value), key);
+	}
+
+	static uint64_t chain(uint64_t key, const std::string& value)
+	{
+		return hash(value.data(), value.size(), chain(key, value.size()));
+	}
+
+private:
+	std::string dir;
+	std::atomic<int> hits[NUM_STAGES], misses[NUM_STAGES];
+
+
+	static const char* stageName(int stage)
+	{
+		static const char* names[NUM_STAGES] = { "mask", "contour", "features" };
+		return names[stage];
+	}
+
+	std::string path(Stage stage, uint64_t key) const
+	{
+		std::stringstream name;
+		name << dir << "/" << stageName(stage) << "/"
+			<< std::hex << std::setw(16) << std::setfill('0') << key;
+		return name.str();
+	}
+
+	bool read(Stage stage, uint64_t key, std::vector<char>& bytes)
+	{
+		std::ifstream in(path(stage, key).c_str(),
+						std::ios::binary | std::ios::ate);
+		if(!in)
+		{
+			misses[stage]++;
+			return false;
+		}
+
+		bytes.resize(in.tellg());
+		in.seekg(0);
+		if(!bytes.empty())
+			in.read(&bytes[0], bytes.size());
+		if(!in)
+		{
+			misses[stage]++;
+			return false;
+		}
+		hits[stage]++;
+		return true;
+	}
+
+	void write(Stage stage, uint64_t key, const void* data, size_t size)
+	{
+		std::string target = path(stage, key);
+		std::stringstream tmp;
+		tmp << target << ".tmp" << std::hash<std::thread::id>()(
+											std::this_thread::get_id());
+
+		{
+			std::ofstream out(tmp.str().c_str(), std::ios::binary);
+			out.write((const char*)data, size);
+			if(!out)
+			{
+				std::remove(tmp.str().c_str());
+				return;
+			}
+		}
+		std::rename(tmp.str().c_str(), target.c_str());
+	}
+
+public:
+	StageCache(const std::string& d) : dir(d)
+	{
+		for(int s = 0; s < NUM_STAGES; s++)
+		{
+			hits[s] = misses[s] = 0;
+			QDir().mkpath(QString("%1/%2").arg(dir.c_str()).arg(stageName(s)));
+		}
+	}
+
+	bool getMask(uint64_t key, cv::Mat& mask)
+	{
+		std::vector<char> bytes;
+		if(!read(MASK, key, bytes))
+			return false;
+		mask = cv::imdecode(cv::Mat(bytes), 0);
+		return !mask.empty();
+	}
+
+	void putMask(uint64_t key, const cv::Mat& mask)
+	{
+		std::vector<uchar> png;
+		if(cv::imencode(".png", mask, png))
+			write(MASK, key, png.empty() ? 0 : &png[0], png.size());
+	}
+
+	bool getContour(uint64_t key, std::vector<cv::Point>& contour)
+	{
+		std::vector<char> bytes;
+		if(!read(CONTOUR, key, bytes) || bytes.size() % sizeof(cv::Point))
+			return false;
+		const cv::Point* p = (const cv::Point*)(bytes.empty() ? 0 : &bytes[0]);
+		contour.assign(p, p + bytes.size() / sizeof(cv::Point));
+		return true;
+	}
+
+	void putContour(uint64_t key, const std::vector<cv::Point>& contour)
+	{
+		write(CONTOUR, key, contour.empty() ? 0 : &contour[0],
+				contour.size() * sizeof(cv::Point));
+	}
+
+	bool getFeatures(uint64_t key, HandFeatures& features)
+	{
+		std::vector<char> bytes;
+		if(!read(FEATURES, key, bytes) || bytes.size() != sizeof(HandFeatures))
+			return false;
+		std::copy(bytes.begin(), bytes.end(), (char*)&features);
+		return true;
+	}
+
+	void putFeatures(uint64_t key, const HandFeatures& features)
+	{
+		write(FEATURES, key, &features, sizeof(features));
+	}
+
+	int getHits(Stage stage) const
+	{
+		return hits[stage];
+	}
+
+	int getMisses(Stage stage) const
+	{
+		return misses[stage];
+	}
+
+	static std::string name(Stage stage)
+	{
+		return stageName(stage);
+	}
+};
+
+#endif
@@ -0,0 +1,38 @@
+#-------------------------------------------------
+#
+# Packs a labelled dataset into a corpus of masks and features
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+QMAKE_CXXFLAGS = -fpermissive -std=c++11 -pthread
+QMAKE_LFLAGS += -pthread
+
+TARGET = gesturecorpus
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+    ../../detectors/skindetector.cpp \
+    ../../detectors/handdetector.cpp
+
+HEADERS  += ../common/framepipeline.h \
+    ../common/stagecache.h \
+    ../../include/gesturecorpus.h \
+    ../../include/gesturedataset.h \
+    ../../include/user.h \
+    ../../include/hand.h \
+    ../../detectors/skindetector.h \
+    ../../detectors/handdetector.h
+
+INCLUDEPATH += /opt/local/include/
+LIBS += -L/opt/local/lib/ \
+   -lopencv_core \
+   -lopencv_imgproc \
+   -lopencv_highgui \
+   -lopencv_objdetect \
+   -lopencv_video \
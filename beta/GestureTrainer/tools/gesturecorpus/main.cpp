@@ -0,0 +1,153 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Runs every frame of a labelled dataset through the skin and hand
+	detectors once and packs the results (hand mask, contour, features,
+	label and calibration) into a corpus, see gesturecorpus.h. Training
+	and evaluating classifiers on the corpus then skips all the image
+	work.
+
+	usage: gesturecorpus <dataset dir> <out.corpus> [--threads n]
+
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+#include "../common/framepipeline.h"
+#include "../../include/gesturecorpus.h"
+
+
+struct CorpusEntry
+{
+	bool read;
+	CorpusRecord record;
+	std::vector<uint16_t> runs;
+	std::vector<cv::Point> contour;
+};
+
+// frames processed between writes, bounds the memory held
+static const int CHUNK_SIZE = 1024;
+
+
+static void process(const GestureDataset& dataset, int first,
+					std::atomic<int>& next, std::vector<CorpusEntry>& entries)
+{
+	FramePipeline pipeline;
+	const std::vector<DatasetFrame>& frames = dataset.getFrames();
+
+	for(int i = next++; i < (int)entries.size(); i = next++)
+	{
+		const DatasetFrame& frame = frames[first + i];
+		CorpusEntry& e = entries[i];
+
+		HandType found;
+		e.read = pipeline.process(dataset, frame, found);
+		if(!e.read)
+			continue;
+
+		const DatasetUser& u = dataset.getUsers()[frame.user];
+		CorpusRecord& r = e.record;
+		r = CorpusRecord();
+		r.label = Hand::translateType(frame.label);
+		r.left = u.left;
+		std::copy(u.angles, u.angles + 5, r.calib);
+
+		const User& user = pipeline.getUser();
+		e.runs.clear();
+		e.contour.clear();
+		if(user.curHand.isNone())
+		{
+			r.features.type = NONE;
+			continue;
+		}
+
+		r.features = user.curFeatures;
+		cv::Rect box(r.features.boxX, r.features.boxY,
+					r.features.boxWidth, r.features.boxHeight);
+		box &= cv::Rect(0, 0, pipeline.getMask().cols, pipeline.getMask().rows);
+		r.maskX = box.x;
+		r.maskY = box.y;
+		r.maskWidth = box.width;
+		r.maskHeight = box.height;
+
+		GestureCorpus::encodeMask(pipeline.getMask()(box), e.runs);
+		e.contour = user.curHand.getContour();
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 3)
+	{
+		std::cerr << "usage: gesturecorpus <dataset dir> <out.corpus>"
+					" [--threads n]" << std::endl;
+		return 1;
+	}
+
+	int threads = std::thread::hardware_concurrency();
+	if(argc > 4 && std::string(argv[3]) == "--threads")
+		threads = std::atoi(argv[4]);
+	threads = std::max(threads, 1);
+
+	GestureDataset dataset;
+	if(!dataset.load(argv[1]) || dataset.getFrames().empty())
+	{
+		std::cerr << "no frames in " << GestureDataset::indexFile(argv[1])
+				<< std::endl;
+		return 1;
+	}
+
+	CorpusWriter writer;
+	if(!writer.open(argv[2]))
+	{
+		std::cerr << "could not write " << argv[2] << std::endl;
+		return 1;
+	}
+
+	const int total = dataset.getFrames().size();
+	int unread = 0;
+	for(int first = 0; first < total; first += CHUNK_SIZE)
+	{
+		std::vector<CorpusEntry> entries(std::min(CHUNK_SIZE, total - first));
+		std::atomic<int> next(0);
+
+		std::vector<std::thread> workers;
+		for(int t = 0; t < threads; t++)
+			workers.push_back(std::thread(process, std::cref(dataset), first,
+										std::ref(next), std::ref(entries)));
+		for(std::thread& w : workers)
+			w.join();
+
+		// written in dataset order, whatever order they finished in
+		for(unsigned int i = 0; i < entries.size(); i++)
+		{
+			if(entries[i].read)
+				writer.add(entries[i].record,
+							dataset.getFrames()[first + i].path,
+							entries[i].runs, entries[i].contour);
+			else
+				unread++;
+		}
+		std::cout << "\r" << std::min(first + CHUNK_SIZE, total) << " / "
+				<< total << std::flush;
+	}
+
+	int written = writer.size();
+	if(!writer.close())
+	{
+		std::cerr << "\ncould not write " << argv[2] << std::endl;
+		return 1;
+	}
+	std::cout << "\n" << written << " frames packed";
+	if(unread)
+		std::cout << ", " << unread << " could not be read";
+	std::cout << std::endl;
+	return 0;
+}
@@ -0,0 +1,348 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Measures recognition on a labelled dataset (see gesturedataset.h, one
+	is recorded by pressing r while training). Every frame is run through
+	the full pipeline, spread over all cores, and the tool reports
+
+		a confusion matrix, rows the labelled gesture and columns the
+		class found
+		the accuracy for each gesture and overall
+		per frame latency percentiles
+
+	Given a corpus (packed by gesturecorpus) instead of a dataset, only
+	the classification is run, on the stored features, which takes a
+	fraction of the time for trying out classifiers.
+
+	With --cache, the skin mask, contour and features of every dataset
+	frame are kept in a directory (see stagecache.h), and a re-run only
+	recomputes the stages after the first one whose code or parameters
+	changed.
+
+	The per frame results can be written out (-o) and a later run
+	compared against them (--baseline) to see which frames a change
+	fixed or broke.
+
+	usage: gestureeval <dataset dir | frames.corpus> [--model gesture.model]
+				[--threads n] [--cache dir] [-o results.dat]
+				[--baseline results.dat]
+
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdlib>
+
+#include "../common/framepipeline.h"
+#include "../../include/gesturecorpus.h"
+
+
+static const int NUM_TYPES = NONE + 1;
+
+struct FrameResult
+{
+	bool read;
+	HandType label, found;
+	double ms;
+};
+
+
+static std::string name(int type)
+{
+	return Hand::typeName((HandType)type).toStdString();
+}
+
+/*
+	Runs frames off a shared counter until there are none left, each
+	thread with its own pipeline
+*/
+static void evaluate(const GestureDataset& dataset, const std::string& model,
+					StageCache* cache, std::atomic<int>& next,
+					std::vector<FrameResult>& results)
+{
+	FramePipeline pipeline;
+	pipeline.setCache(cache);
+	if(!model.empty())
+		pipeline.loadModel(model);
+
+	const std::vector<DatasetFrame>& frames = dataset.getFrames();
+	for(int i = next++; i < (int)frames.size(); i = next++)
+	{
+		FrameResult& r = results[i];
+		r.label = Hand::translateType(frames[i].label);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		HandType found;
+		r.read = pipeline.process(dataset, frames[i], found);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		r.found = found;
+		r.ms = std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+/*
+	The same over the records of a corpus, classifying the stored features
+	as User::setCurHand would
+*/
+static void evaluateCorpus(const GestureCorpus& corpus,
+						const std::string& model, std::atomic<int>& next,
+						std::vector<FrameResult>& results)
+{
+	User user;
+	if(!model.empty())
+		user.loadModel(model);
+
+	for(int i = next++; i < corpus.size(); i = next++)
+	{
+		const CorpusRecord& rec = corpus.record(i);
+		FrameResult& r = results[i];
+		r.read = true;
+		r.label = (HandType)rec.label;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		if(rec.features.type == NONE)
+			r.found = NONE;
+		else
+		{
+			user.setCalibration(rec.calib, rec.left);
+			r.found = user.classify(rec.features);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		r.ms = std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+// path#label#found#ms per line
+static void writeResults(const std::string& filename,
+						const std::vector<std::string>& paths,
+						const std::vector<FrameResult>& results)
+{
+	std::ofstream out(filename.c_str());
+	for(unsigned int i = 0; i < results.size(); i++)
+	{
+		if(!results[i].read)
+			continue;
+		out << paths[i] << "#" << name(results[i].label)
+			<< "#" << name(results[i].found) << "#" << results[i].ms << "\n";
+	}
+}
+
+static void compareBaseline(const std::string& filename,
+							const std::vector<std::string>& paths,
+							const std::vector<FrameResult>& results)
+{
+	std::ifstream in(filename.c_str());
+	if(!in)
+	{
+		std::cerr << "could not read baseline " << filename << std::endl;
+		return;
+	}
+
+	// path -> class found in the baseline
+	std::map<std::string, std::string> before;
+	std::string line;
+	while(std::getline(in, line))
+	{
+		std::stringstream stream(line);
+		std::string path, label, found;
+		if(std::getline(stream, path, '#') && std::getline(stream, label, '#')
+			&& std::getline(stream, found, '#'))
+			before[path] = found;
+	}
+
+	int fixed = 0, broken = 0, changed = 0;
+	std::cout << "\nchanged since baseline:" << std::endl;
+	for(unsigned int i = 0; i < results.size(); i++)
+	{
+		const FrameResult& r = results[i];
+		const std::string& path = paths[i];
+		std::map<std::string, std::string>::const_iterator it = before.find(path);
+		if(!r.read || it == before.end() || it->second == name(r.found))
+			continue;
+
+		changed++;
+		bool wasRight = it->second == name(r.label),
+			isRight = r.found == r.label;
+		fixed += !wasRight && isRight;
+		broken += wasRight && !isRight;
+		std::cout << "  " << path << " (" << name(r.label) << "): "
+			<< it->second << " -> " << name(r.found) << std::endl;
+	}
+	std::cout << changed << " changed, " << fixed << " fixed, "
+		<< broken << " broken" << std::endl;
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	if(sorted.empty())
+		return 0;
+	int i = std::min((int)(p * sorted.size()), (int)sorted.size() - 1);
+	return sorted[i];
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 2)
+	{
+		std::cerr << "usage: gestureeval <dataset dir | frames.corpus>"
+					" [--model gesture.model] [--threads n] [--cache dir]"
+					" [-o results.dat] [--baseline results.dat]" << std::endl;
+		return 1;
+	}
+
+	std::string model, output, baseline, cacheDir;
+	int threads = std::thread::hardware_concurrency();
+	for(int i = 2; i + 1 < argc; i += 2)
+	{
+		std::string opt = argv[i];
+		if(opt == "--model")
+			model = argv[i + 1];
+		else if(opt == "--threads")
+			threads = std::atoi(argv[i + 1]);
+		else if(opt == "--cache")
+			cacheDir = argv[i + 1];
+		else if(opt == "-o")
+			output = argv[i + 1];
+		else if(opt == "--baseline")
+			baseline = argv[i + 1];
+	}
+	threads = std::max(threads, 1);
+
+	// frames come from either a corpus or a dataset, paths name them in
+	// the results either way
+	GestureCorpus corpus;
+	GestureDataset dataset;
+	std::vector<std::string> paths;
+	const bool fromCorpus = GestureCorpus::isCorpus(argv[1]);
+	if(fromCorpus && corpus.open(argv[1]))
+	{
+		for(int i = 0; i < corpus.size(); i++)
+			paths.push_back(corpus.name(corpus.record(i)));
+	}
+	else if(!fromCorpus && dataset.load(argv[1]))
+	{
+		for(const DatasetFrame& frame : dataset.getFrames())
+			paths.push_back(frame.path);
+	}
+	if(paths.empty())
+	{
+		std::cerr << "no frames in " << argv[1] << std::endl;
+		return 1;
+	}
+
+	std::unique_ptr<StageCache> cache;
+	if(!cacheDir.empty() && !fromCorpus)
+		cache.reset(new StageCache(cacheDir));
+
+	std::vector<FrameResult> results(paths.size());
+	std::atomic<int> next(0);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> workers;
+	for(int t = 0; t < threads; t++)
+	{
+		if(fromCorpus)
+			workers.push_back(std::thread(evaluateCorpus, std::cref(corpus),
+						std::cref(model), std::ref(next), std::ref(results)));
+		else
+			workers.push_back(std::thread(evaluate, std::cref(dataset),
+						std::cref(model), cache.get(), std::ref(next),
+						std::ref(results)));
+	}
+	for(std::thread& w : workers)
+		w.join();
+	auto end = std::chrono::high_resolution_clock::now();
+
+
+	//------------------Accuracy----------------
+	int confusion[NUM_TYPES][NUM_TYPES] = {};
+	int total = 0, correct = 0, unread = 0;
+	std::vector<double> latencies;
+	for(const FrameResult& r : results)
+	{
+		if(!r.read)
+		{
+			unread++;
+			continue;
+		}
+		confusion[r.label][r.found]++;
+		total++;
+		correct += r.label == r.found;
+		latencies.push_back(r.ms);
+	}
+
+	std::cout << "confusion (rows labelled, columns found):\n" << std::setw(8) << "";
+	for(int f = 0; f < NUM_TYPES; f++)
+		std::cout << std::setw(8) << name(f);
+	std::cout << std::endl;
+	for(int l = 0; l < NUM_TYPES; l++)
+	{
+		int row = 0;
+		for(int f = 0; f < NUM_TYPES; f++)
+			row += confusion[l][f];
+		if(row == 0)
+			continue;
+
+		std::cout << std::setw(8) << name(l);
+		for(int f = 0; f < NUM_TYPES; f++)
+			std::cout << std::setw(8) << confusion[l][f];
+		std::cout << "   " << std::fixed << std::setprecision(1)
+			<< 100.0 * confusion[l][l] / row << "% of " << row << std::endl;
+	}
+	std::cout << "accuracy: " << 100.0 * correct / std::max(total, 1)
+		<< "% of " << total << " frames";
+	if(unread)
+		std::cout << " (" << unread << " could not be read)";
+	std::cout << std::endl;
+	//----------------END Accuracy--------------------
+
+
+	//------------------Latency----------------
+	std::sort(latencies.begin(), latencies.end());
+	double sum = 0;
+	for(double ms : latencies)
+		sum += ms;
+
+	std::cout << std::setprecision(2) << "latency (ms/frame): mean "
+		<< sum / std::max((int)latencies.size(), 1)
+		<< "  p50 " << percentile(latencies, 0.5)
+		<< "  p90 " << percentile(latencies, 0.9)
+		<< "  p99 " << percentile(latencies, 0.99)
+		<< "  max " << (latencies.empty() ? 0 : latencies.back())
+		<< "\nwall: " << std::chrono::duration<double>(end - start).count()
+		<< " s on " << threads << " threads" << std::endl;
+	//----------------END Latency--------------------
+
+
+	if(cache)
+	{
+		std::cout << "cache hits:";
+		for(int s = 0; s < StageCache::NUM_STAGES; s++)
+		{
+			StageCache::Stage stage = (StageCache::Stage)s;
+			std::cout << "  " << StageCache::name(stage) << " "
+				<< cache->getHits(stage) << "/"
+				<< cache->getHits(stage) + cache->getMisses(stage);
+		}
+		std::cout << std::endl;
+	}
+
+	if(!output.empty())
+		writeResults(output, paths, results);
+	if(!baseline.empty())
+		compareBaseline(baseline, paths, results);
+	return 0;
+}
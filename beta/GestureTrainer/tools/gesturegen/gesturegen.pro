@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Compiles a trained gesture model into C++ source
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+QMAKE_CXXFLAGS = -fpermissive -std=c++11
+
+TARGET = gesturegen
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+
+SOURCES += main.cpp
+
+HEADERS  += ../../include/gesturemodel.h \
+    ../../include/handfeatures.h
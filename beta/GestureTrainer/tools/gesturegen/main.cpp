@@ -0,0 +1,113 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Turns a trained gesture model into C++ source, so kiosk builds can
+	compile the classifier in rather than load and walk a model file.
+	The tree is unrolled into nested branches on constant thresholds,
+	with no allocation and no table lookups at runtime.
+
+	usage: gesturegen <gesture.model> <gesturetree.h>
+
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "../../include/gesturemodel.h"
+
+
+static std::string indent(int depth)
+{
+	return std::string(depth, '\t');
+}
+
+// A float literal that reads back as exactly v
+static std::string floatLiteral(float v)
+{
+	std::stringstream str;
+	str.precision(std::numeric_limits<float>::max_digits10);
+	str << v;
+
+	std::string lit = str.str();
+	if(lit.find_first_of(".e") == std::string::npos)
+		lit += ".0";
+	return lit + "f";
+}
+
+// Writes the subtree under node as nested ifs, returns its depth
+static int emitNode(std::ostream& out, const std::vector<GestureModel::Node>& nodes,
+					int node, int depth)
+{
+	const GestureModel::Node& n = nodes[node];
+	if(n.feature < 0)
+	{
+		out << indent(depth) << "return " << n.label << ";\n";
+		return 0;
+	}
+
+	out << indent(depth) << "if(x[" << n.feature << "] <= "
+		<< floatLiteral(n.threshold) << ")\n" << indent(depth) << "{\n";
+	int left = emitNode(out, nodes, n.left, depth + 1);
+	out << indent(depth) << "}\n" << indent(depth) << "else\n"
+		<< indent(depth) << "{\n";
+	int right = emitNode(out, nodes, n.right, depth + 1);
+	out << indent(depth) << "}\n";
+
+	return 1 + std::max(left, right);
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 3)
+	{
+		std::cerr << "usage: gesturegen <gesture.model> <gesturetree.h>"
+				<< std::endl;
+		return 1;
+	}
+
+	GestureModel model;
+	if(!model.load(argv[1]))
+	{
+		std::cerr << "could not load model " << argv[1] << std::endl;
+		return 1;
+	}
+
+	std::stringstream body;
+	int depth = emitNode(body, model.getNodes(), 0, 1);
+
+	std::ofstream out(argv[2]);
+	if(!out)
+	{
+		std::cerr << "could not write " << argv[2] << std::endl;
+		return 1;
+	}
+
+	out << "/*\n\n"
+		"\tGenerated by tools/gesturegen, do not edit.\n\n"
+		"\tThe trained gesture model compiled in as branches, used in place\n"
+		"\tof a model file when GESTURE_COMPILED_MODEL is defined.\n\n"
+		"*/\n\n\n"
+		"#ifndef GESTURETREE_H\n"
+		"#define GESTURETREE_H\n\n"
+		"#include \"../include/gesturemodel.h\"\n\n\n"
+		"static constexpr int GESTURE_TREE_NODES = "
+			<< model.getNodes().size() << ",\n"
+		"\t\t\t\t\tGESTURE_TREE_DEPTH = " << depth << ";\n\n"
+		"// Label (a HandType) for a feature vector, -1 if the tree is empty\n"
+		"inline int compiledGestureClass(const float x[GESTURE_FEATURES])\n"
+		"{\n"
+		// a lone leaf never looks at x
+		<< (depth == 0 ? "\t(void)x;\n" : "") << body.str() <<
+		"}\n\n"
+		"#endif\n";
+
+	std::cout << "wrote " << model.getNodes().size() << " nodes, depth "
+		<< depth << " to " << argv[2] << std::endl;
+	return 0;
+}
@@ -0,0 +1,266 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Searches the detector parameters (see detectorparams.h) over a
+	labelled dataset, either the full grid of the values below or a
+	random sample of it, and reports the configurations on the accuracy /
+	latency Pareto front: every one that is more accurate than all the
+	faster ones.
+
+	Frames are spread over all cores. Each frame is decoded and converted
+	to HSV once and then run through every configuration, so only the
+	stages the parameters affect are repeated. Latency is the time from
+	the HSV frame to the class.
+
+	Besides the DetectorParams, the HSV skin range each frame was recorded
+	with is widened by hsvPad on every side.
+
+	usage: gesturesweep <dataset dir> [--grid | --random n] [--seed s]
+						[--model gesture.model] [--threads n]
+						[-o detector.prefs.dat]
+
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <cstdlib>
+
+#include "../common/framepipeline.h"
+
+
+struct SweepConfig
+{
+	DetectorParams params;
+	int hsvPad;
+};
+
+struct SweepResult
+{
+	int correct, total;
+	double ms;
+};
+
+
+// Values searched for each knob, the defaults are among them
+static const int MORPH_SIZES[] = { 3, 5, 7 },
+				COLOR_REDUCES[] = { 0, 4, 8 },
+				MIN_HAND_SIZES[] = { 1000, 2000, 4000 },
+				HSV_PADS[] = { 0, 5, 10 };
+static const double MIN_DEFECT_SIZES[] = { 5, 10, 15 },
+					MIN_TIP_RATIOS[] = { 1.3, 1.5, 1.7 },
+					MAX_FINGER_RATIOS[] = { 40, 50, 60 };
+static const float RETRY_RADII[] = { 1.05f, 1.1f, 1.2f };
+static const int VALUES = 3;
+
+
+// The i'th configuration of the grid, counting each knob as a base 3 digit
+static SweepConfig gridConfig(int i)
+{
+	SweepConfig c;
+	c.params.morphSize = MORPH_SIZES[i % VALUES]; i /= VALUES;
+	c.params.colorReduce = COLOR_REDUCES[i % VALUES]; i /= VALUES;
+	c.params.minHandSize = MIN_HAND_SIZES[i % VALUES]; i /= VALUES;
+	c.params.minDefectSize = MIN_DEFECT_SIZES[i % VALUES]; i /= VALUES;
+	c.params.minTipRatio = MIN_TIP_RATIOS[i % VALUES]; i /= VALUES;
+	c.params.maxFingerRatio = MAX_FINGER_RATIOS[i % VALUES]; i /= VALUES;
+	c.params.retryRadius = RETRY_RADII[i % VALUES]; i /= VALUES;
+	c.hsvPad = HSV_PADS[i % VALUES];
+	return c;
+}
+
+static const int GRID_SIZE = VALUES * VALUES * VALUES * VALUES *
+								VALUES * VALUES * VALUES * VALUES;
+
+
+static void sweep(const GestureDataset& dataset,
+				const std::vector<SweepConfig>& configs,
+				const std::string& model, std::atomic<int>& next,
+				std::vector<SweepResult>& totals, std::mutex& totalsLock)
+{
+	FramePipeline pipeline;
+	if(!model.empty())
+		pipeline.loadModel(model);
+
+	std::vector<SweepResult> results(configs.size(), SweepResult());
+	const std::vector<DatasetFrame>& frames = dataset.getFrames();
+	cv::Mat hsv, color;
+
+	for(int i = next++; i < (int)frames.size(); i = next++)
+	{
+		const DatasetFrame& frame = frames[i];
+		cv::Mat img = cv::imread(dataset.framePath(frame), frame.isMask ? 0 : 1);
+		if(img.empty())
+			continue;
+
+		// shared by every configuration
+		if(frame.isMask)
+			cv::cvtColor(img, color, CV_GRAY2BGR);
+		else
+			cv::cvtColor(img, hsv, CV_BGR2HSV);
+		const HandType label = Hand::translateType(frame.label);
+		const DatasetUser& u = dataset.getUsers()[frame.user];
+
+		for(unsigned int c = 0; c < configs.size(); c++)
+		{
+			DatasetUser padded = u;
+			padded.hsvMin -= cv::Scalar::all(configs[c].hsvPad);
+			padded.hsvMax += cv::Scalar::all(configs[c].hsvPad);
+			pipeline.setUser(padded);
+			pipeline.setParams(configs[c].params);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			HandType found = frame.isMask ? pipeline.processMask(color, img) :
+											pipeline.processHSV(img, hsv);
+			auto end = std::chrono::high_resolution_clock::now();
+
+			results[c].correct += found == label;
+			results[c].total++;
+			results[c].ms += std::chrono::duration<double, std::milli>(
+														end - start).count();
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(totalsLock);
+	for(unsigned int c = 0; c < configs.size(); c++)
+	{
+		totals[c].correct += results[c].correct;
+		totals[c].total += results[c].total;
+		totals[c].ms += results[c].ms;
+	}
+}
+
+static void printConfig(const SweepConfig& c, const SweepResult& r)
+{
+	std::cout << std::fixed << std::setprecision(1)
+		<< std::setw(7) << 100.0 * r.correct / std::max(r.total, 1) << "%"
+		<< std::setprecision(2) << std::setw(9) << r.ms / std::max(r.total, 1)
+		<< "   morph " << c.params.morphSize
+		<< "  reduce " << c.params.colorReduce
+		<< "  hand " << c.params.minHandSize
+		<< "  defect " << c.params.minDefectSize
+		<< "  tip " << c.params.minTipRatio
+		<< "  finger " << c.params.maxFingerRatio
+		<< "  retry " << c.params.retryRadius
+		<< "  hsvPad " << c.hsvPad << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 2)
+	{
+		std::cerr << "usage: gesturesweep <dataset dir> [--grid | --random n]"
+					" [--seed s] [--model gesture.model] [--threads n]"
+					" [-o detector.prefs.dat]" << std::endl;
+		return 1;
+	}
+
+	std::string model, output;
+	int threads = std::thread::hardware_concurrency(), samples = 64;
+	unsigned int seed = 1;
+	bool grid = false;
+	for(int i = 2; i < argc; i++)
+	{
+		std::string opt = argv[i];
+		if(opt == "--grid")
+			grid = true;
+		else if(i + 1 >= argc)
+			break;
+		else if(opt == "--random")
+			samples = std::atoi(argv[++i]);
+		else if(opt == "--seed")
+			seed = std::atoi(argv[++i]);
+		else if(opt == "--model")
+			model = argv[++i];
+		else if(opt == "--threads")
+			threads = std::atoi(argv[++i]);
+		else if(opt == "-o")
+			output = argv[++i];
+	}
+	threads = std::max(threads, 1);
+
+	GestureDataset dataset;
+	if(!dataset.load(argv[1]) || dataset.getFrames().empty())
+	{
+		std::cerr << "no frames in " << GestureDataset::indexFile(argv[1])
+				<< std::endl;
+		return 1;
+	}
+
+	// the defaults first, so there is always something to compare against
+	std::vector<SweepConfig> configs(1, SweepConfig());
+	configs[0].hsvPad = 0;
+	if(grid)
+	{
+		for(int i = 0; i < GRID_SIZE; i++)
+			configs.push_back(gridConfig(i));
+	}
+	else
+	{
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> pick(0, GRID_SIZE - 1);
+		for(int i = 0; i < samples; i++)
+			configs.push_back(gridConfig(pick(rng)));
+	}
+
+	std::cout << configs.size() << " configurations, "
+		<< dataset.getFrames().size() << " frames" << std::endl;
+
+	std::vector<SweepResult> results(configs.size(), SweepResult());
+	std::mutex resultsLock;
+	std::atomic<int> next(0);
+
+	std::vector<std::thread> workers;
+	for(int t = 0; t < threads; t++)
+		workers.push_back(std::thread(sweep, std::cref(dataset),
+						std::cref(configs), std::cref(model), std::ref(next),
+						std::ref(results), std::ref(resultsLock)));
+	for(std::thread& w : workers)
+		w.join();
+
+
+	//------------------Pareto Front----------------
+	// fastest first, keep each one more accurate than everything faster
+	std::vector<int> order(configs.size());
+	for(unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](int a, int b) {
+		return results[a].ms < results[b].ms;
+	});
+
+	std::vector<int> front;
+	int best = -1;
+	for(int i : order)
+	{
+		if(best >= 0 && results[i].correct <= results[best].correct)
+			continue;
+		front.push_back(i);
+		best = i;
+	}
+
+	std::cout << "\n accuracy  ms/frame\ndefaults:\n";
+	printConfig(configs[0], results[0]);
+	std::cout << "pareto front:\n";
+	for(int i : front)
+		printConfig(configs[i], results[i]);
+	//----------------END Pareto Front--------------------
+
+
+	// the most accurate, for GestureTrainer's detector prefs
+	if(!output.empty())
+	{
+		if(configs[best].params.save(output))
+			std::cout << "saved the most accurate to " << output << std::endl;
+		else
+			std::cerr << "could not write " << output << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Offline trainer for the GestureTrainer gesture model
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+QMAKE_CXXFLAGS = -fpermissive -std=c++11
+
+TARGET = gesturetrain
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+
+SOURCES += main.cpp
+
+HEADERS  += treetrainer.h \
+    ../../include/gesturemodel.h \
+    ../../include/handfeatures.h \
+    ../../include/gesturecorpus.h \
+    ../../include/hand.h \
+    ../../include/user.h
+
+INCLUDEPATH += /opt/local/include/
+LIBS += -L/opt/local/lib/ \
+   -lopencv_core \
+   -lopencv_imgproc \
+   -lopencv_video \
@@ -0,0 +1,146 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Offline trainer for the gesture model. Reads labelled feature vectors
+	(as recorded by pressing r while training, one "label#f0#f1#..." per
+	line) or a corpus packed by gesturecorpus, checks the tree on every
+	5th sample held out, then trains on everything and writes the model
+	file loaded by GestureTrainer.
+
+	usage: gesturetrain <features.dat | frames.corpus> <gesture.model>
+						[max depth]
+
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "../../include/user.h"
+#include "../../include/gesturemodel.h"
+#include "../../include/gesturecorpus.h"
+#include "treetrainer.h"
+
+
+static bool readSamples(const std::string& filename,
+						std::vector<GestureSample>& samples)
+{
+	std::ifstream in(filename.c_str());
+	if(!in)
+		return false;
+
+	std::string line;
+	while(std::getline(in, line))
+	{
+		std::stringstream stream(line);
+		std::string field;
+		if(!std::getline(stream, field, '#'))
+			continue;
+
+		GestureSample sample;
+		sample.label = Hand::translateType(field);
+		if(sample.label == NONE)
+			continue;
+
+		int i = 0;
+		for( ; i < GESTURE_FEATURES && std::getline(stream, field, '#'); i++)
+			sample.x[i] = std::atof(field.c_str());
+
+		// skip lines from a different feature layout
+		if(i == GESTURE_FEATURES && !std::getline(stream, field, '#'))
+			samples.push_back(sample);
+	}
+	return true;
+}
+
+// Samples straight from a corpus, the features are used in place
+static bool readCorpus(const std::string& filename,
+						std::vector<GestureSample>& samples)
+{
+	GestureCorpus corpus;
+	if(!corpus.open(filename))
+		return false;
+
+	samples.reserve(corpus.size());
+	for(int i = 0; i < corpus.size(); i++)
+	{
+		const CorpusRecord& r = corpus.record(i);
+		if(r.features.type == NONE || r.label == NONE)
+			continue;
+
+		GestureSample sample;
+		sample.label = r.label;
+		gestureFeatures(r.features, r.calib, r.left, sample.x);
+		samples.push_back(sample);
+	}
+	return true;
+}
+
+static double accuracy(const GestureModel& model,
+						const std::vector<GestureSample>& samples)
+{
+	if(samples.empty())
+		return 0;
+
+	int correct = 0;
+	for(const GestureSample& s : samples)
+		correct += model.classify(s.x) == s.label;
+	return (double)correct / samples.size();
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 3)
+	{
+		std::cerr << "usage: gesturetrain <features.dat | frames.corpus>"
+					" <gesture.model> [max depth]" << std::endl;
+		return 1;
+	}
+
+	std::vector<GestureSample> samples;
+	bool read = GestureCorpus::isCorpus(argv[1]) ?
+					readCorpus(argv[1], samples) : readSamples(argv[1], samples);
+	if(!read || samples.empty())
+	{
+		std::cerr << "no samples in " << argv[1] << std::endl;
+		return 1;
+	}
+
+	TreeTrainer trainer(argc > 3 ? std::atoi(argv[3]) : 12);
+
+	// hold out every 5th sample to see how well it generalizes
+	std::vector<GestureSample> train, test;
+	for(unsigned int i = 0; i < samples.size(); i++)
+		(i % 5 == 4 ? test : train).push_back(samples[i]);
+
+	GestureModel model = trainer.train(train);
+	std::cout << "samples: " << samples.size()
+		<< "\ntrain accuracy: " << accuracy(model, train)
+		<< "\nheld out accuracy: " << accuracy(model, test) << std::endl;
+
+	// final model on everything
+	model = trainer.train(samples);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	volatile int sink = 0;
+	for(const GestureSample& s : samples)
+		sink += model.classify(s.x);
+	auto end = std::chrono::high_resolution_clock::now();
+	double nsEach = std::chrono::duration<double, std::nano>(end - start).count()
+					/ samples.size();
+
+	std::cout << "nodes: " << model.getNodes().size()
+		<< "\ninference: " << nsEach << " ns/sample" << std::endl;
+
+	if(!model.save(argv[2]))
+	{
+		std::cerr << "could not write " << argv[2] << std::endl;
+		return 1;
+	}
+	return 0;
+}
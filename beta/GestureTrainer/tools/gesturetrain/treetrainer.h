@@ -0,0 +1,147 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Grows a GestureModel decision tree from labelled feature vectors
+	(CART, gini impurity). Nodes are stored parent first, which is what
+	GestureModel::load expects.
+
+*/
+
+
+#ifndef TREETRAINER_H
+#define TREETRAINER_H
+
+#include <vector>
+#include <algorithm>
+
+#include "../../include/gesturemodel.h"
+
+
+struct GestureSample
+{
+	int label;
+	float x[GESTURE_FEATURES];
+};
+
+
+class TreeTrainer
+{
+
+private:
+	int maxDepth, minLeaf;
+
+	const std::vector<GestureSample>* samples;
+	std::vector<GestureModel::Node> nodes;
+
+	// labels are HandType values, which all fit in here
+	static const int NUM_LABELS = 16;
+
+
+	static double gini(const int counts[NUM_LABELS], int total)
+	{
+		if(total == 0)
+			return 0;
+		double sum = 0;
+		for(int l = 0; l < NUM_LABELS; l++)
+		{
+			double p = (double)counts[l] / total;
+			sum += p * p;
+		}
+		return 1 - sum;
+	}
+
+	// Builds the subtree over idx[begin, end) and returns its root
+	int build(std::vector<int>& idx, int begin, int end, int depth)
+	{
+		const std::vector<GestureSample>& s = *samples;
+		int nodeIdx = nodes.size();
+		nodes.push_back(GestureModel::Node());
+
+		int counts[NUM_LABELS] = { 0 };
+		for(int i = begin; i < end; i++)
+			counts[s[idx[i]].label]++;
+		int n = end - begin;
+		int majority = std::max_element(counts, counts + NUM_LABELS) - counts;
+
+		GestureModel::Node leaf = { -1, (int16_t)majority, 0, 0, 0 };
+		double parentGini = gini(counts, n);
+		if(depth >= maxDepth || n < 2 * minLeaf || parentGini == 0)
+		{
+			nodes[nodeIdx] = leaf;
+			return nodeIdx;
+		}
+
+		// try every threshold between distinct values of every feature
+		int bestFeature = -1;
+		float bestThreshold = 0;
+		double bestGini = parentGini;
+		for(int f = 0; f < GESTURE_FEATURES; f++)
+		{
+			std::sort(idx.begin() + begin, idx.begin() + end,
+				[&](int a, int b) { return s[a].x[f] < s[b].x[f]; });
+
+			int left[NUM_LABELS] = { 0 }, right[NUM_LABELS];
+			std::copy(counts, counts + NUM_LABELS, right);
+			for(int i = begin; i < end - 1; i++)
+			{
+				int l = s[idx[i]].label;
+				left[l]++;
+				right[l]--;
+
+				int nl = i - begin + 1, nr = n - nl;
+				float a = s[idx[i]].x[f], b = s[idx[i+1]].x[f];
+				if(a == b || nl < minLeaf || nr < minLeaf)
+					continue;
+
+				double g = (nl * gini(left, nl) + nr * gini(right, nr)) / n;
+				if(g < bestGini)
+				{
+					bestGini = g;
+					bestFeature = f;
+					bestThreshold = (a + b) / 2;
+				}
+			}
+		}
+
+		if(bestFeature < 0)
+		{
+			nodes[nodeIdx] = leaf;
+			return nodeIdx;
+		}
+
+		int mid = std::partition(idx.begin() + begin, idx.begin() + end,
+				[&](int a) { return s[a].x[bestFeature] <= bestThreshold; })
+				- idx.begin();
+
+		int left = build(idx, begin, mid, depth + 1);
+		int right = build(idx, mid, end, depth + 1);
+
+		GestureModel::Node node = { (int16_t)bestFeature, (int16_t)majority,
+									bestThreshold, left, right };
+		nodes[nodeIdx] = node;
+		return nodeIdx;
+	}
+
+public:
+	TreeTrainer(int depth = 12, int leaf = 3) : maxDepth(depth), minLeaf(leaf)
+	{
+	}
+
+	GestureModel train(const std::vector<GestureSample>& data)
+	{
+		nodes.clear();
+		if(data.empty())
+			return GestureModel();
+
+		samples = &data;
+		std::vector<int> idx(data.size());
+		for(unsigned int i = 0; i < idx.size(); i++)
+			idx[i] = i;
+
+		build(idx, 0, idx.size(), 0);
+		return GestureModel(nodes);
+	}
+};
+
+#endif
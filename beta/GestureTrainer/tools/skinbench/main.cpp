@@ -0,0 +1,288 @@
+/*
+
+	Created by: Jason Carlisle Mann (on2valhalla | jcm2207@columbia.edu)
+
+	Compares the skin color models (see skinmodels.h) on recorded frames:
+	either the color frames of a labelled dataset (see gesturedataset.h),
+	each with the HSV range of the user it was recorded by, or any frame
+	source (see framesource.h) with one HSV range. For each model it
+	reports
+
+		ms per frame and megapixels per second, converting a BGR frame
+		to the model's color space, thresholding and filtering it
+		the mean intersection over union of its masks with the HSV box
+		masks, the range the frames were calibrated with
+		the share of frames a hand is found in, and of labelled frames
+		classified right
+
+	The frames are decoded into memory first, so only the skin stage is
+	timed, on one thread. The histogram model is trained on the HSV box
+	masks of TRAIN_FRAMES frames spread over the set, so its overlap is
+	somewhat flattered on those.
+
+	usage: skinbench <dataset dir | source> [--frames n]
+				[--hsv hmin,smin,vmin,hmax,smax,vmax] [--model gesture.model]
+
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../common/framepipeline.h"
+#include "../../include/framesource.h"
+
+#include <QFile>
+
+
+static const SkinMode MODES[] = { SKIN_HSV, SKIN_YCRCB, SKIN_RG, SKIN_HISTOGRAM };
+static const int NUM_MODES = sizeof(MODES) / sizeof(MODES[0]);
+
+static const int TRAIN_FRAMES = 10;
+
+
+struct BenchFrame
+{
+	cv::Mat image;
+	int user;
+	bool labelled;
+	HandType label;
+};
+
+struct BenchResult
+{
+	double ms, iou;
+	long pixels;
+	int found, correct, labelled;
+};
+
+
+// The color frames of a dataset, up to max
+static bool loadDataset(const std::string& dir, int max,
+						std::vector<DatasetUser>& users,
+						std::vector<BenchFrame>& frames)
+{
+	GestureDataset dataset;
+	if(!dataset.load(dir))
+		return false;
+	users = dataset.getUsers();
+
+	const std::vector<DatasetFrame>& all = dataset.getFrames();
+	for(unsigned int i = 0; i < all.size() && (int)frames.size() < max; i++)
+	{
+		if(all[i].isMask)
+			continue;
+		BenchFrame f;
+		f.image = cv::imread(dataset.framePath(all[i]), 1);
+		if(f.image.empty())
+			continue;
+		f.user = all[i].user;
+		f.labelled = true;
+		f.label = Hand::translateType(all[i].label);
+		frames.push_back(f);
+	}
+	return true;
+}
+
+// Up to max frames of a source, unlabelled, all with the one user
+static bool loadSource(const std::string& spec, int max,
+						std::vector<BenchFrame>& frames)
+{
+	std::unique_ptr<FrameSource> source(openFrameSource(spec));
+	if(!source)
+		return false;
+
+	BenchFrame f;
+	f.user = 0;
+	f.labelled = false;
+	f.label = NONE;
+	while((int)frames.size() < max && source->read(f.image))
+	{
+		frames.push_back(f);
+		// a new buffer for the next one
+		f.image = cv::Mat();
+	}
+	return true;
+}
+
+static double intersectionOverUnion(const cv::Mat& a, const cv::Mat& b)
+{
+	int both = cv::countNonZero(a & b), either = cv::countNonZero(a | b);
+	return either ? (double)both / either : 1;
+}
+
+// Trains the histogram model on the HSV box masks of frames spread over the set
+static bool trainHistogram(SkinDetector& detector,
+						const std::vector<DatasetUser>& users,
+						const std::vector<BenchFrame>& frames)
+{
+	std::vector<cv::Vec3b> skin;
+	cv::Mat hsv;
+	const int step = std::max<int>(frames.size() / TRAIN_FRAMES, 1);
+	for(unsigned int i = 0; i < frames.size(); i += step)
+	{
+		const DatasetUser& u = users[frames[i].user];
+		detector.setThreshold(u.hsvMin, u.hsvMax);
+		cv::cvtColor(frames[i].image, hsv, CV_BGR2HSV);
+		cv::Mat mask = detector.processHSV(hsv);
+
+		for(int r = 0; r < hsv.rows; r++)
+		{
+			const cv::Vec3b *p = hsv.ptr<cv::Vec3b>(r);
+			const uchar *m = mask.ptr<uchar>(r);
+			for(int c = 0; c < hsv.cols; c++)
+				if(m[c])
+					skin.push_back(p[c]);
+		}
+	}
+	if(skin.empty())
+		return false;
+
+	// every pixel in one column, all of it skin
+	cv::Mat pixels(skin.size(), 1, CV_8UC3, &skin[0]);
+	return detector.trainHistogram(pixels,
+					cv::Mat(pixels.rows, 1, CV_8U, cv::Scalar(255)));
+}
+
+/*
+	Runs every frame through one model. The HSV model's masks are kept in
+	reference, the others are compared against them.
+*/
+static BenchResult bench(SkinMode mode, SkinDetector& detector,
+						const std::vector<DatasetUser>& users,
+						const std::vector<BenchFrame>& frames,
+						const std::string& model,
+						std::vector<cv::Mat>& reference)
+{
+	BenchResult r = BenchResult();
+	FramePipeline pipeline;
+	if(!model.empty())
+		pipeline.loadModel(model);
+
+	int user = -1;
+	for(unsigned int i = 0; i < frames.size(); i++)
+	{
+		const BenchFrame& f = frames[i];
+		// converting the range is not part of a frame's work
+		if(f.user != user)
+		{
+			user = f.user;
+			detector.setThreshold(users[user].hsvMin, users[user].hsvMax);
+			pipeline.setUser(users[user]);
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		cv::Mat mask = detector.processBGR(f.image, mode);
+		auto end = std::chrono::high_resolution_clock::now();
+		r.ms += std::chrono::duration<double, std::milli>(end - start).count();
+		r.pixels += f.image.total();
+
+		if(mode == SKIN_HSV)
+			reference[i] = mask.clone();
+		r.iou += intersectionOverUnion(mask, reference[i]);
+
+		HandType found = pipeline.processMask(f.image, mask);
+		r.found += found != NONE;
+		if(f.labelled)
+		{
+			r.labelled++;
+			r.correct += found == f.label;
+		}
+	}
+	return r;
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 2)
+	{
+		std::cerr << "usage: skinbench <dataset dir | source> [--frames n]"
+					" [--hsv hmin,smin,vmin,hmax,smax,vmax]"
+					" [--model gesture.model]" << std::endl;
+		return 1;
+	}
+
+	std::string model;
+	int maxFrames = 300;
+	// the default location preset
+	int hsv[6] = { 0, 40, 93, 20, 255, 255 };
+	for(int i = 2; i + 1 < argc; i += 2)
+	{
+		std::string opt = argv[i];
+		if(opt == "--frames")
+			maxFrames = std::atoi(argv[i + 1]);
+		else if(opt == "--hsv")
+			std::sscanf(argv[i + 1], "%d,%d,%d,%d,%d,%d", &hsv[0], &hsv[1],
+						&hsv[2], &hsv[3], &hsv[4], &hsv[5]);
+		else if(opt == "--model")
+			model = argv[i + 1];
+	}
+
+	std::vector<DatasetUser> users;
+	std::vector<BenchFrame> frames;
+	const std::string input = argv[1];
+	if(!QFile::exists(GestureDataset::indexFile(input).c_str()) ||
+		!loadDataset(input, maxFrames, users, frames))
+	{
+		if(!loadSource(input, maxFrames, frames))
+		{
+			std::cerr << "could not open " << input << std::endl;
+			return 1;
+		}
+		DatasetUser u;
+		u.name = "source";
+		u.left = false;
+		std::fill(u.angles, u.angles + 5, 0.0f);
+		u.hsvMin = cv::Scalar(hsv[0], hsv[1], hsv[2]);
+		u.hsvMax = cv::Scalar(hsv[3], hsv[4], hsv[5]);
+		users.push_back(u);
+	}
+	if(frames.empty())
+	{
+		std::cerr << "no color frames in " << input << std::endl;
+		return 1;
+	}
+
+	std::cout << frames.size() << " frames" << std::endl << std::endl;
+	std::cout << std::left << std::setw(16) << "model"
+		<< std::right << std::setw(10) << "ms/frame"
+		<< std::setw(10) << "Mpix/s"
+		<< std::setw(10) << "IoU"
+		<< std::setw(10) << "hand"
+		<< std::setw(10) << "correct" << std::endl;
+
+	std::vector<cv::Mat> reference(frames.size());
+	for(int m = 0; m < NUM_MODES; m++)
+	{
+		SkinDetector detector;
+		if(MODES[m] == SKIN_HISTOGRAM && !trainHistogram(detector, users, frames))
+		{
+			std::cout << std::left << std::setw(16) << skinModeName(MODES[m])
+				<< "no skin to train on" << std::endl;
+			continue;
+		}
+
+		BenchResult r = bench(MODES[m], detector, users, frames, model,
+							reference);
+		std::cout << std::left << std::setw(16) << skinModeName(MODES[m])
+			<< std::right << std::fixed
+			<< std::setw(10) << std::setprecision(2) << r.ms / frames.size()
+			<< std::setw(10) << std::setprecision(1) << r.pixels / (r.ms * 1000)
+			<< std::setw(10) << std::setprecision(3) << r.iou / frames.size()
+			<< std::setw(9) << std::setprecision(1)
+				<< 100.0 * r.found / frames.size() << "%";
+		if(r.labelled)
+			std::cout << std::setw(9) << 100.0 * r.correct / r.labelled << "%";
+		else
+			std::cout << std::setw(10) << "-";
+		std::cout << std::endl;
+	}
+
+	return 0;
+}
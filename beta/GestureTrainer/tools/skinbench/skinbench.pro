@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# Throughput and mask quality of the skin color models
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+QMAKE_CXXFLAGS = -fpermissive -std=c++11 -pthread
+QMAKE_LFLAGS += -pthread
+
+TARGET = skinbench
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+    ../../detectors/skindetector.cpp \
+    ../../detectors/handdetector.cpp
+
+HEADERS  += ../common/framepipeline.h \
+    ../common/stagecache.h \
+    ../../include/framesource.h \
+    ../../include/gesturedataset.h \
+    ../../include/user.h \
+    ../../include/hand.h \
+    ../../detectors/skindetector.h \
+    ../../detectors/skinmodels.h \
+    ../../detectors/handdetector.h
+
+INCLUDEPATH += /opt/local/include/
+LIBS += -L/opt/local/lib/ \
+   -lopencv_core \
+   -lopencv_imgproc \
+   -lopencv_highgui \
+   -lopencv_objdetect \
+   -lopencv_video \